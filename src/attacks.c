@@ -0,0 +1,244 @@
+#include "attacks.h"
+
+#include <assert.h>
+#include <stdbool.h>
+
+SliderMagic rookMagics[64];
+SliderMagic bishopMagics[64];
+
+Bitboard knightAttackTable[64];
+Bitboard kingAttackTable[64];
+Bitboard pawnAttackTable[2][64];
+
+Bitboard betweenTable[64][64];
+Bitboard lineTable[64][64];
+
+// every tile's attack sets packed back to back, sized for the sum of
+// 2^(mask bits) over all 64 tiles
+static Bitboard rookTable[102400];
+static Bitboard bishopTable[5248];
+
+typedef struct
+{
+    int8_t row, file;
+} Direction;
+
+static const Direction rookDirections[4] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+static const Direction bishopDirections[4] = {
+    {1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+static const Direction knightSteps[8] = {
+    {1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}};
+static const Direction kingSteps[8] = {
+    {1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1}, {0, -1}, {1, -1}};
+// white pawns move towards row 0, black pawns towards row 7
+static const Direction pawnSteps[2][2] = {
+    [COLOUR_BLACK] = {{1, -1}, {1, 1}},
+    [COLOUR_WHITE] = {{-1, -1}, {-1, 1}},
+};
+
+static bool onBoard(int row, int file)
+{
+    return row >= 0 && row < 8 && file >= 0 && file < 8;
+}
+
+// tiles reachable with a single step in any of the directions
+static Bitboard stepAttacks(Position p, const Direction *steps, size_t n)
+{
+    Bitboard attacks = BITBOARD_EMPTY;
+    for (size_t i = 0; i < n; i++)
+    {
+        int row  = p / 8 + steps[i].row;
+        int file = p % 8 + steps[i].file;
+        if (onBoard(row, file))
+            attacks |= bitboardSquare(row * 8 + file);
+    }
+    return attacks;
+}
+
+// walk each ray until it leaves the board or hits a piece
+static Bitboard
+slidingAttacks(Position p, Bitboard occupied, const Direction *directions)
+{
+    Bitboard attacks = BITBOARD_EMPTY;
+    for (size_t i = 0; i < 4; i++)
+    {
+        int row  = p / 8 + directions[i].row;
+        int file = p % 8 + directions[i].file;
+        while (onBoard(row, file))
+        {
+            Position tile = row * 8 + file;
+            attacks |= bitboardSquare(tile);
+            if (bitboardTest(occupied, tile))
+                break;
+            row += directions[i].row;
+            file += directions[i].file;
+        }
+    }
+    return attacks;
+}
+
+// the last tile on each ray is left out, it is attacked whether or not
+// something stands on it
+static Bitboard sliderMask(Position p, const Direction *directions)
+{
+    Bitboard mask = BITBOARD_EMPTY;
+    for (size_t i = 0; i < 4; i++)
+    {
+        int row  = p / 8 + directions[i].row;
+        int file = p % 8 + directions[i].file;
+        while (onBoard(row + directions[i].row, file + directions[i].file))
+        {
+            mask |= bitboardSquare(row * 8 + file);
+            row += directions[i].row;
+            file += directions[i].file;
+        }
+    }
+    return mask;
+}
+
+#if !defined(__BMI2__)
+// the generator is reseeded at the start of each row. these seeds were
+// picked because they find every magic in the row after few attempts,
+// which keeps startup fast
+static const uint64_t rowSeeds[8] = {1776, 826, 1312, 2205, 739, 2078, 974, 30};
+static uint64_t randomState;
+
+static uint64_t random64()
+{
+    randomState ^= randomState >> 12;
+    randomState ^= randomState << 25;
+    randomState ^= randomState >> 27;
+    return randomState * 0x2545f4914f6cdd1d;
+}
+
+// magics with few set bits are found much faster
+static Bitboard sparseRandom() { return random64() & random64() & random64(); }
+#endif
+
+static void initSlider(
+    SliderMagic *magics,
+    Bitboard *table,
+    size_t tableSize,
+    const Direction *directions)
+{
+    static Bitboard occupancy[4096];
+    static Bitboard reference[4096];
+#if !defined(__BMI2__)
+    // which magic attempt last wrote each index, saves clearing the table
+    static unsigned epoch[4096];
+    static unsigned attempt;
+#endif
+
+    Bitboard *next = table;
+    for (Position p = 0; p < 64; p++)
+    {
+#if !defined(__BMI2__)
+        if (p % 8 == 0)
+            randomState = rowSeeds[p / 8];
+#endif
+
+        SliderMagic *m = &magics[p];
+        m->mask        = sliderMask(p, directions);
+        m->shift       = 64 - bitboardCount(m->mask);
+        m->magic       = 0;
+        m->attacks     = next;
+
+        // enumerate every subset of the mask
+        size_t size     = 0;
+        Bitboard subset = BITBOARD_EMPTY;
+        do
+        {
+            occupancy[size] = subset;
+            reference[size] = slidingAttacks(p, subset, directions);
+            size++;
+            subset = (subset - m->mask) & m->mask;
+        } while (subset);
+
+        next += size;
+        assert(next <= table + tableSize);
+        (void)tableSize;
+
+#if defined(__BMI2__)
+        for (size_t i = 0; i < size; i++)
+            m->attacks[sliderIndex(m, occupancy[i])] = reference[i];
+#else
+        // try random magics until one maps every subset without a
+        // destructive collision
+        for (bool found = false; !found;)
+        {
+            m->magic = sparseRandom();
+            if (bitboardCount((m->mask * m->magic) >> 56) < 6)
+                continue;
+
+            attempt++;
+            found = true;
+            for (size_t i = 0; i < size && found; i++)
+            {
+                unsigned index = sliderIndex(m, occupancy[i]);
+                if (epoch[index] < attempt)
+                {
+                    epoch[index]      = attempt;
+                    m->attacks[index] = reference[i];
+                }
+                else if (m->attacks[index] != reference[i])
+                    found = false;
+            }
+        }
+#endif
+    }
+}
+
+__attribute__((constructor)) void initAttacks()
+{
+    for (Position p = 0; p < 64; p++)
+    {
+        knightAttackTable[p] = stepAttacks(p, knightSteps, 8);
+        kingAttackTable[p]   = stepAttacks(p, kingSteps, 8);
+        pawnAttackTable[COLOUR_BLACK][p] =
+            stepAttacks(p, pawnSteps[COLOUR_BLACK], 2);
+        pawnAttackTable[COLOUR_WHITE][p] =
+            stepAttacks(p, pawnSteps[COLOUR_WHITE], 2);
+    }
+
+    initSlider(
+        rookMagics,
+        rookTable,
+        sizeof(rookTable) / sizeof(rookTable[0]),
+        rookDirections);
+    initSlider(
+        bishopMagics,
+        bishopTable,
+        sizeof(bishopTable) / sizeof(bishopTable[0]),
+        bishopDirections);
+
+    for (Position a = 0; a < 64; a++)
+    {
+        for (Position b = 0; b < 64; b++)
+        {
+            Bitboard ends = bitboardSquare(a) | bitboardSquare(b);
+            betweenTable[a][b] = BITBOARD_EMPTY;
+            lineTable[a][b]    = BITBOARD_EMPTY;
+            if (a == b)
+                continue;
+
+            // two tiles are aligned if a piece on an empty board reaches one
+            // from the other. the tiles between are where their rays meet
+            if (bitboardTest(bishopAttacks(a, BITBOARD_EMPTY), b))
+            {
+                lineTable[a][b] = (bishopAttacks(a, BITBOARD_EMPTY) &
+                                   bishopAttacks(b, BITBOARD_EMPTY)) |
+                                  ends;
+                betweenTable[a][b] = bishopAttacks(a, bitboardSquare(b)) &
+                                     bishopAttacks(b, bitboardSquare(a));
+            }
+            else if (bitboardTest(rookAttacks(a, BITBOARD_EMPTY), b))
+            {
+                lineTable[a][b] = (rookAttacks(a, BITBOARD_EMPTY) &
+                                   rookAttacks(b, BITBOARD_EMPTY)) |
+                                  ends;
+                betweenTable[a][b] = rookAttacks(a, bitboardSquare(b)) &
+                                     rookAttacks(b, bitboardSquare(a));
+            }
+        }
+    }
+}
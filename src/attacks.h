@@ -0,0 +1,88 @@
+#pragma once
+
+// precomputed attack sets for every piece type. the tables are built once
+// at startup, sliding pieces are looked up with magic bitboards, or with
+// PEXT when the target supports BMI2.
+
+#include "board.h"
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+// lookup data for one sliding piece on one tile
+typedef struct
+{
+    Bitboard mask;     // tiles whose occupancy can block the slider
+    Bitboard magic;    // multiplier mapping occupancy to a table index
+    Bitboard *attacks; // this tile's slice of the attack table
+    unsigned shift;    // 64 - number of bits in mask
+} SliderMagic;
+
+extern SliderMagic rookMagics[64];
+extern SliderMagic bishopMagics[64];
+
+extern Bitboard knightAttackTable[64];
+extern Bitboard kingAttackTable[64];
+extern Bitboard pawnAttackTable[2][64];
+
+// tiles strictly between two tiles sharing a row, column or diagonal
+extern Bitboard betweenTable[64][64];
+// the whole row, column or diagonal through two tiles, empty if they are not
+// aligned
+extern Bitboard lineTable[64][64];
+
+// build the attack tables. it is run automatically before main, but can be
+// called again safely
+void initAttacks();
+
+static inline unsigned sliderIndex(const SliderMagic *m, Bitboard occupied)
+{
+#if defined(__BMI2__)
+    return (unsigned)_pext_u64(occupied, m->mask);
+#else
+    return (unsigned)(((occupied & m->mask) * m->magic) >> m->shift);
+#endif
+}
+
+// tiles a rook on p attacks, the first blocker on each ray is included
+static inline Bitboard rookAttacks(Position p, Bitboard occupied)
+{
+    const SliderMagic *m = &rookMagics[p];
+    return m->attacks[sliderIndex(m, occupied)];
+}
+
+// tiles a bishop on p attacks, the first blocker on each ray is included
+static inline Bitboard bishopAttacks(Position p, Bitboard occupied)
+{
+    const SliderMagic *m = &bishopMagics[p];
+    return m->attacks[sliderIndex(m, occupied)];
+}
+
+static inline Bitboard queenAttacks(Position p, Bitboard occupied)
+{
+    return rookAttacks(p, occupied) | bishopAttacks(p, occupied);
+}
+
+static inline Bitboard knightAttacks(Position p)
+{
+    return knightAttackTable[p];
+}
+
+static inline Bitboard kingAttacks(Position p) { return kingAttackTable[p]; }
+
+// tiles a pawn of colour c on p captures on
+static inline Bitboard pawnAttacks(Colour c, Position p)
+{
+    return pawnAttackTable[c][p];
+}
+
+static inline Bitboard betweenSquares(Position a, Position b)
+{
+    return betweenTable[a][b];
+}
+
+static inline Bitboard lineThrough(Position a, Position b)
+{
+    return lineTable[a][b];
+}
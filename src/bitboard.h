@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// a set of squares, bit n is set if tile n is in the set
+typedef uint64_t Bitboard;
+
+#define BITBOARD_EMPTY ((Bitboard)0)
+#define BITBOARD_FULL  (~(Bitboard)0)
+
+// tiles in the first and last column of the board
+#define BITBOARD_FILE_A ((Bitboard)0x0101010101010101)
+#define BITBOARD_FILE_H ((Bitboard)0x8080808080808080)
+
+// get a bitboard with only one tile set
+static inline Bitboard bitboardSquare(uint8_t tile)
+{
+    return (Bitboard)1 << tile;
+}
+
+// check if a tile is in the set
+static inline bool bitboardTest(Bitboard b, uint8_t tile)
+{
+    return (b >> tile) & 1;
+}
+
+// count the tiles in the set
+static inline int bitboardCount(Bitboard b) { return __builtin_popcountll(b); }
+
+// get the lowest tile in the set. the set must not be empty
+static inline uint8_t bitboardFirst(Bitboard b)
+{
+    return (uint8_t)__builtin_ctzll(b);
+}
+
+// remove the lowest tile from the set and return it
+static inline uint8_t bitboardPopFirst(Bitboard *b)
+{
+    uint8_t tile = bitboardFirst(*b);
+    *b &= *b - 1;
+    return tile;
+}
@@ -1,22 +1,46 @@
 #include "board.h"
+#include "nnue.h"
+#include "position.h"
+#include "zobrist.h"
 
 #include <assert.h>
 #include <string.h>
-#include <stdio.h>
 #include <stdbool.h>
-#include <ctype.h>
 
-// board index 0 is bottom left, index 64 is top right,
-// goes horizontal
+// external definitions for the inline helpers in board.h, used wherever the
+// compiler decides not to inline them
+extern inline Colour getColour(Piece p);
+extern inline void setColour(Piece *p, Colour c);
+
+// board index 0 is a8, the top left from white's side, and index 63 is h1.
+// tiles run along each rank, row 0 being the eighth rank
+
+// remove every piece from the board
+static void clearTiles(Board *b)
+{
+    memset(b->tiles, PIECE_BLANK, sizeof(b->tiles));
+    memset(b->pieces, 0, sizeof(b->pieces));
+    memset(b->colours, 0, sizeof(b->colours));
+    b->pieces[PIECE_BLANK] = BITBOARD_FULL;
+    b->hash                = 0;
+    b->pawnHash            = 0;
+    b->middlegameScore     = 0;
+    b->endgameScore        = 0;
+}
 
 Board createBoard()
 {
     Board b;
-    for (uint8_t i = 0; i < 64; i++)
-        b.tiles[i] = PIECE_BLANK;
-    b.lastMove[0] = UINT8_MAX;
-    b.lastMove[1] = UINT8_MAX;
-    b.turn        = COLOUR_WHITE;
+    clearTiles(&b);
+    b.accumulator   = NULL;
+    b.lastMove[0]   = UINT8_MAX;
+    b.lastMove[1]   = UINT8_MAX;
+    b.en_passant    = -1;
+    b.castling      = 0;
+    b.turn          = COLOUR_WHITE;
+    b.halfmoveClock = 0;
+    b.moveCount     = 0;
+    b.hash          = generateChecksum(&b);
 
     return b;
 }
@@ -41,6 +65,28 @@ void setPiece(Board *b, Position p, Piece piece)
     assert(p < 64);
     assert(piece < PIECE_PIECE_MAX);
 
+    // swap the old piece out of the occupancy masks and the new one in
+    Piece old    = b->tiles[p];
+    Bitboard bit = bitboardSquare(p);
+    b->pieces[old & 0x7f] ^= bit;
+    b->pieces[piece & 0x7f] ^= bit;
+    if ((old & 0x7f) != PIECE_BLANK)
+        b->colours[getColour(old)] ^= bit;
+    if ((piece & 0x7f) != PIECE_BLANK)
+        b->colours[getColour(piece)] ^= bit;
+    b->hash ^= zobristPiece(old, p) ^ zobristPiece(piece, p);
+    if ((old & 0x7f) == PIECE_PAWN)
+        b->pawnHash ^= zobristPiece(old, p);
+    if ((piece & 0x7f) == PIECE_PAWN)
+        b->pawnHash ^= zobristPiece(piece, p);
+
+    TaperedScore removed = pieceSquareScore(old, p);
+    TaperedScore added   = pieceSquareScore(piece, p);
+    b->middlegameScore += added.middlegame - removed.middlegame;
+    b->endgameScore += added.endgame - removed.endgame;
+    if (b->accumulator)
+        updateAccumulator(b->accumulator, p, old, piece);
+
     b->tiles[p] = piece;
 }
 
@@ -50,129 +96,17 @@ void movePiece(Board *b, Position initial, Position final)
     setPiece(b, initial, PIECE_BLANK);        // set initial square to blank
 }
 
-int generateChecksum(Board *b) { return 0; }
-
-Piece getPieceFromChar(char c)
+uint64_t generateChecksum(Board *b)
 {
-    switch (c)
-    {
-    case 'p': return PIECE_PAWN | 0x80;
-    case 'n': return PIECE_KNIGHT | 0x80;
-    case 'b': return PIECE_BISHOP | 0x80;
-    case 'r': return PIECE_ROOK | 0x80;
-    case 'q': return PIECE_QUEEN | 0x80;
-    case 'k': return PIECE_KING | 0x80;
-    case 'P': return PIECE_PAWN & 0x7f;
-    case 'N': return PIECE_KNIGHT & 0x7f;
-    case 'B': return PIECE_BISHOP & 0x7f;
-    case 'R': return PIECE_ROOK & 0x7f;
-    case 'Q': return PIECE_QUEEN & 0x7f;
-    case 'K': return PIECE_KING & 0x7f;
-    }
-    printf("Invalid piece '%c'", c);
-    return PIECE_BLANK;
+    uint64_t hash = 0;
+    for (Position p = 0; p < 64; p++)
+        hash ^= zobristPiece(b->tiles[p], p);
+
+    hash ^= zobristCastling[b->castling];
+    if (b->en_passant >= 0)
+        hash ^= zobristEnPassant[b->en_passant];
+    if (b->turn == COLOUR_WHITE)
+        hash ^= zobristTurn;
+
+    return hash;
 }
-void loadPosition(Board *b, const char *fen)
-{
-    // set board to blank
-    for (size_t i = 0; i < 64; i++)
-        b->tiles[i] = PIECE_BLANK;
-    size_t len = strlen(fen);
-    uint8_t x = 0, y = 7;
-
-    size_t field = 0; // < 6
-    for (size_t i = 0; i < len; i++)
-    {
-        switch (fen[i])
-        {
-        case ' ':
-            return;
-            field++;
-            break;
-        case '/':
-            // move to next line
-            x = 0;
-            y--;
-            break;
-        //     break;
-        case '-': break;
-        case 'w':
-            if (field == 1)
-                0; // whites turn
-            break;
-        case 'b':
-            if (field == 1)
-            {
-                0; // whites turn;
-                break;
-            }
-
-        default:
-
-            // castling
-            if (field == 2)
-            {
-                switch (fen[i])
-                {
-                case 'k': b->w_castle_k = true; break;
-                case 'q': b->w_castle_q = true; break;
-                case 'K': b->b_castle_k = true; break;
-                case 'Q': b->b_castle_q = true; break;
-                }
-                break;
-            }
-
-            // moves
-            Piece p;
-            if (field == 0)
-            {
-                if (isdigit(fen[i]))
-                {
-                    x += (fen[i] - '0');
-                }
-                else if (((p = getPieceFromChar(fen[i])) & 0x7f) != PIECE_BLANK)
-                {
-                    b->tiles[y * 8 + x] = p;
-                    x++;
-                    // assert(x < 8 && "Invalid FEN");
-                }
-                else
-                {
-                    assert(0 && "Invalid FEN");
-                }
-            }
-            break;
-        }
-    }
-
-    // Initialize tiles array to 0
-    //     memset(b->tiles, 0, sizeof(b->tiles));
-
-    //     int i = 0, j = 0;
-    //     while (*fen != '\0')
-    //     {
-    //         if (*fen == '/')
-    //         {
-    //             i++;
-    //             j = 0;
-    //         }
-    //         else if (isdigit(*fen))
-    //         {
-    //             j += (*fen - '0');
-    //         }
-    //         else if (*fen == ' ')
-    //         {
-    //             break;
-    //         }
-    //         else
-    //         {
-    //             int piece = getPieceFromChar(*fen);
-    //             if (piece != -1)
-    //             {
-    //                 b->tiles[i * 8 + j] = piece;
-    //                 j++;
-    //             }
-    //         }
-    //         fen++;
-    //     }
-}
\ No newline at end of file
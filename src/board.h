@@ -4,6 +4,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "bitboard.h"
+
 typedef int8_t Piece;
 
 // negative peices are black
@@ -43,42 +45,96 @@ inline void setColour(Piece *p, Colour c)
     }
 }
 
+// get the colour playing against c
+static inline Colour otherColour(Colour c)
+{
+    return c == COLOUR_WHITE ? COLOUR_BLACK : COLOUR_WHITE;
+}
+
+// castling rights, one bit for each side a colour may still castle to
+enum
+{
+    CASTLE_WHITE_KING  = 1 << 0,
+    CASTLE_WHITE_QUEEN = 1 << 1,
+    CASTLE_BLACK_KING  = 1 << 2,
+    CASTLE_BLACK_QUEEN = 1 << 3,
+};
+
 // represents a pieces position
 typedef uint8_t Position;
 
+// defined in nnue.h
+typedef struct NnueAccumulator NnueAccumulator;
+
 /*
-Board goes from left to right and up
-16 --->
-8  --->
-0  --->
+Board goes from left to right and down, as seen from white's side
+0  ---> a8 .. h8
+8  ---> a7 .. h7
+16 ---> a6 .. h6
+...
+56 ---> a1 .. h1
 */
 typedef struct
 {
     uint8_t tiles[64];
+
+    // occupancy masks kept in sync with tiles by setPiece.
+    // pieces[PIECE_BLANK] holds the empty tiles
+    Bitboard pieces[PIECE_PIECE_MAX];
+    Bitboard colours[2];
+
     Position lastMove[2];
 
-    int en_passant;
-    bool w_castle_k, w_castle_q;
-    bool b_castle_k, b_castle_q;
+    int en_passant; // file of a pawn that just moved two tiles, or -1
+    uint8_t castling;
 
     Colour turn;
 
+    // zobrist hash of the position, kept up to date as the board changes
+    uint64_t hash;
+    // the same, but only for the pawns. the pawn structure is evaluated once
+    // for each key
+    uint64_t pawnHash;
+
+    // material and piece square sums from white's point of view. kept up to
+    // date by setPiece, so the evaluation never has to look at every tile
+    int middlegameScore;
+    int endgameScore;
+
+    // first layer sums of the evaluation network, kept up to date by
+    // setPiece when set. the board does not own them, each search thread
+    // attaches its own
+    NnueAccumulator *accumulator;
+
+    // moves since the last capture or pawn move, for the fifty move rule
+    unsigned halfmoveClock;
     size_t moveCount;
 } Board;
 
 Board createBoard();
 
-// create a checksum of the board in order to verify moves online
-int generateChecksum(Board *b);
+// create a checksum of the board in order to verify moves online.
+// it is the zobrist hash computed from scratch, so it should always equal
+// the incrementally updated Board::hash
+uint64_t generateChecksum(Board *b);
 
 Piece getPiece(Board *b, uint8_t position);
 
 void movePiece(Board *b, Position initial, Position final);
 
+// get every tile with a piece on it
+static inline Bitboard getOccupied(const Board *b)
+{
+    return b->colours[COLOUR_BLACK] | b->colours[COLOUR_WHITE];
+}
+
+// get the tiles holding a piece type of one colour
+static inline Bitboard getPieces(const Board *b, Piece type, Colour c)
+{
+    return b->pieces[type & 0x7f] & b->colours[c];
+}
+
 void setPiece(Board *b, Position p, Piece piece);
 
 // generate a position using the rank and file
 Position generatePosition(uint8_t file, uint8_t rank);
-
-// load a position from a string to a board
-void loadPosition(Board *b, const char *pos);
\ No newline at end of file
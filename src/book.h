@@ -0,0 +1,86 @@
+#pragma once
+
+// opening books in the Polyglot format
+//
+// a book is a file of 16 byte entries sorted by position key, each holding
+// a move and its weight, written big endian. the file is mapped rather
+// than read, so opening a book takes no time however large it is and every
+// process using the same book shares its pages. a position's moves are
+// found by a binary search for its key
+//
+// keys are built as Polyglot builds them, from its 781 random numbers: one
+// for each piece on each tile, one for each castling right, one for each en
+// passant file and one for white to move. books written by other programs
+// can be read, and books written here can be read by them
+
+#include "board.h"
+#include "moves.h"
+
+#include <stdio.h>
+
+#define BOOK_ENTRY_SIZE 16
+
+// the layout of the random numbers
+#define BOOK_KEY_PIECES 0
+#define BOOK_KEY_CASTLING 768
+#define BOOK_KEY_EN_PASSANT 772
+#define BOOK_KEY_TURN 780
+#define BOOK_KEY_COUNT 781
+
+// most moves a position has in a book that are looked at
+#define BOOK_MAX_MOVES 64
+
+// an entry as it is in the file
+typedef struct
+{
+    uint64_t key;
+    // to file, to rank, from file and from rank in 3 bits each, then the
+    // promotion piece from 1 for a knight to 4 for a queen. castling is
+    // written as the king taking its own rook
+    uint16_t move;
+    uint16_t weight;
+    uint32_t learn;
+} BookEntry;
+
+// one of a position's moves, legal in it
+typedef struct
+{
+    PackedMove move;
+    uint16_t weight;
+} BookMove;
+
+typedef struct
+{
+    const uint8_t *entries;
+    size_t count;
+
+    void *map;
+    size_t mapLength;
+} OpeningBook;
+
+// the key of a position. en passant is only included when a pawn of the
+// side to move stands next to the pawn that moved, as Polyglot does
+uint64_t getBookKey(const Board *b);
+
+// a legal move written as a book writes it
+uint16_t encodeBookMove(PackedMove m);
+
+// map a book. returns false if it can not be read or is not a whole number
+// of entries
+bool openBook(const char *path, OpeningBook *book);
+void closeBook(OpeningBook *book);
+
+// the book's moves for a position, up to max of them. entries for moves
+// that are not legal in the position are left out
+size_t probeBook(
+    const OpeningBook *book, Board *b, BookMove *moves, size_t max);
+
+// choose one of the book's moves for a position, each with a chance in
+// proportion to its weight. random is any random number. returns
+// MOVE_NONE if the book has no moves for it
+PackedMove pickBookMove(const OpeningBook *book, Board *b, uint64_t random);
+
+// sort entries by key and merge entries for the same move, adding their
+// weights, then write them as a book. moves left without any weight are
+// not written. the entries are changed. returns false if writing fails
+bool writeBook(FILE *file, BookEntry *entries, size_t count);
@@ -0,0 +1,446 @@
+#include "fen.h"
+#include "moves.h"
+#include "zobrist.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// castling rights, and where the king and rook must be for each
+static const struct
+{
+    char letter;
+    uint8_t right;
+    Position king;
+    Position rook;
+    Piece colour;
+} castleRights[4] = {
+    {'K', CASTLE_WHITE_KING, 60, 63, 0x80},
+    {'Q', CASTLE_WHITE_QUEEN, 60, 56, 0x80},
+    {'k', CASTLE_BLACK_KING, 4, 7, 0},
+    {'q', CASTLE_BLACK_QUEEN, 4, 0, 0},
+};
+
+// white pieces are upper case, indexed by piece type
+static const char pieceLetters[] = " PNBRQK";
+
+const char *getFenErrorName(FenError error)
+{
+    switch (error)
+    {
+    case FEN_OK: return "ok";
+    case FEN_BAD_PIECE: return "unknown piece";
+    case FEN_BAD_BOARD: return "not eight ranks of eight tiles";
+    case FEN_BAD_KINGS: return "not one king each";
+    case FEN_BAD_COUNT: return "more than 16 pieces of a colour";
+    case FEN_BAD_PAWNS: return "pawn on the first or last rank";
+    case FEN_BAD_TURN: return "bad side to move";
+    case FEN_BAD_CASTLING: return "bad castling rights";
+    case FEN_BAD_EN_PASSANT: return "bad en passant tile";
+    case FEN_BAD_CLOCK: return "bad move clocks";
+    case FEN_ILLEGAL: return "side to move can take the king";
+    }
+    return "unknown error";
+}
+
+static Piece getPieceFromChar(char c)
+{
+    for (Piece p = PIECE_PAWN; p <= PIECE_KING; p++)
+    {
+        if (c == pieceLetters[p])
+            return p | 0x80;
+        if (c == pieceLetters[p] + ('a' - 'A'))
+            return p;
+    }
+    return PIECE_BLANK;
+}
+
+static bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+// fields are separated by spaces, and the last is followed by the end of
+// the string, a space or a line break
+static bool isFieldEnd(char c)
+{
+    return c == '\0' || c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static const char *skipSpaces(const char *s)
+{
+    while (*s == ' ' || *s == '\t')
+        s++;
+    return s;
+}
+
+// read a decimal number. returns NULL if there is none or it is too long
+static const char *readNumber(const char *s, unsigned *value)
+{
+    if (!isDigit(*s))
+        return NULL;
+    *value = 0;
+    for (size_t digits = 0; isDigit(*s); s++, digits++)
+    {
+        if (digits == 6)
+            return NULL;
+        *value = *value * 10 + (*s - '0');
+    }
+    return s;
+}
+
+static FenError readPieces(Board *b, const char **text)
+{
+    const char *s = *text;
+    unsigned file = 0, row = 0;
+    for (; !isFieldEnd(*s); s++)
+    {
+        if (*s == '/')
+        {
+            if (file != 8 || ++row > 7)
+                return FEN_BAD_BOARD;
+            file = 0;
+        }
+        else if (*s >= '1' && *s <= '8')
+        {
+            file += *s - '0';
+            if (file > 8)
+                return FEN_BAD_BOARD;
+        }
+        else
+        {
+            Piece p = getPieceFromChar(*s);
+            if (p == PIECE_BLANK)
+                return FEN_BAD_PIECE;
+            if (file > 7)
+                return FEN_BAD_BOARD;
+            setPiece(b, row * 8 + file, p);
+            file++;
+        }
+    }
+    if (file != 8 || row != 7)
+        return FEN_BAD_BOARD;
+
+    *text = s;
+    return FEN_OK;
+}
+
+static FenError checkPieces(const Board *b)
+{
+    Bitboard kings = b->pieces[PIECE_KING];
+    if (__builtin_popcountll(kings & b->colours[COLOUR_WHITE]) != 1 ||
+        __builtin_popcountll(kings & b->colours[COLOUR_BLACK]) != 1)
+        return FEN_BAD_KINGS;
+
+    // no more than a side starts with, which is all a packed position holds
+    if (__builtin_popcountll(b->colours[COLOUR_WHITE]) > 16 ||
+        __builtin_popcountll(b->colours[COLOUR_BLACK]) > 16)
+        return FEN_BAD_COUNT;
+
+    // row 0 is the eighth rank
+    const Bitboard backRanks = 0xffULL | 0xffULL << 56;
+    if (b->pieces[PIECE_PAWN] & backRanks)
+        return FEN_BAD_PAWNS;
+    return FEN_OK;
+}
+
+static FenError readCastling(Board *b, const char **text)
+{
+    const char *s = *text;
+    if (*s == '-')
+    {
+        *text = s + 1;
+        return FEN_OK;
+    }
+
+    for (; !isFieldEnd(*s); s++)
+    {
+        size_t i = 0;
+        while (i < 4 && castleRights[i].letter != *s)
+            i++;
+        if (i == 4 || (b->castling & castleRights[i].right))
+            return FEN_BAD_CASTLING;
+
+        const Piece king = PIECE_KING | castleRights[i].colour;
+        const Piece rook = PIECE_ROOK | castleRights[i].colour;
+        if ((Piece)b->tiles[castleRights[i].king] != king ||
+            (Piece)b->tiles[castleRights[i].rook] != rook)
+            return FEN_BAD_CASTLING;
+        b->castling |= castleRights[i].right;
+    }
+    if (s == *text)
+        return FEN_BAD_CASTLING;
+
+    *text = s;
+    return FEN_OK;
+}
+
+// only the file is kept. the target is behind a pawn of the side that just
+// moved, on the sixth rank when white is to move and the third otherwise
+static FenError readEnPassant(Board *b, const char **text)
+{
+    const char *s = *text;
+    if (*s == '-')
+    {
+        *text = s + 1;
+        return FEN_OK;
+    }
+
+    const char rank = b->turn == COLOUR_WHITE ? '6' : '3';
+    if (*s < 'a' || *s > 'h' || s[1] != rank)
+        return FEN_BAD_EN_PASSANT;
+
+    const int file     = *s - 'a';
+    const Position pawn = (b->turn == COLOUR_WHITE ? 3 : 4) * 8 + file;
+    Piece moved         = PIECE_PAWN;
+    setColour(&moved, otherColour(b->turn));
+    if ((Piece)b->tiles[pawn] != moved)
+        return FEN_BAD_EN_PASSANT;
+
+    b->en_passant = file;
+    *text         = s + 2;
+    return FEN_OK;
+}
+
+static FenError readFields(Board *b, const char *s, const char **end)
+{
+    FenError error = readPieces(b, &s);
+    if (error == FEN_OK)
+        error = checkPieces(b);
+    if (error != FEN_OK)
+        return error;
+
+    s = skipSpaces(s);
+    if ((*s != 'w' && *s != 'b') || !isFieldEnd(s[1]))
+        return FEN_BAD_TURN;
+    b->turn = *s == 'w' ? COLOUR_WHITE : COLOUR_BLACK;
+
+    s     = skipSpaces(s + 1);
+    error = readCastling(b, &s);
+    if (error != FEN_OK)
+        return error;
+    if (!isFieldEnd(*s))
+        return FEN_BAD_CASTLING;
+
+    s     = skipSpaces(s);
+    error = readEnPassant(b, &s);
+    if (error != FEN_OK)
+        return error;
+    if (!isFieldEnd(*s))
+        return FEN_BAD_EN_PASSANT;
+
+    // the clocks are optional, but come as a pair. the move count is kept
+    // in plies
+    unsigned halfmoves = 0, fullmoves = 1;
+    s = skipSpaces(s);
+    if (isDigit(*s))
+    {
+        s = readNumber(s, &halfmoves);
+        if (s == NULL || !isFieldEnd(*s))
+            return FEN_BAD_CLOCK;
+        s = readNumber(skipSpaces(s), &fullmoves);
+        if (s == NULL || !isFieldEnd(*s))
+            return FEN_BAD_CLOCK;
+        s = skipSpaces(s);
+    }
+    b->halfmoveClock = halfmoves;
+    b->moveCount =
+        (fullmoves > 0 ? fullmoves - 1 : 0) * 2 + (b->turn == COLOUR_BLACK);
+
+    if (end)
+        *end = s;
+    else if (s[strspn(s, " \t\r\n")] != '\0')
+        return FEN_BAD_CLOCK;
+
+    if (isKingAttacked(b, otherColour(b->turn)))
+        return FEN_ILLEGAL;
+    return FEN_OK;
+}
+
+FenError parseFEN(Board *b, const char *fen, const char **end)
+{
+    *b = createBoard();
+
+    FenError error = readFields(b, fen, end);
+    if (error != FEN_OK)
+    {
+        *b = createBoard();
+        return error;
+    }
+
+    // setPiece has hashed the pieces. the empty board's hash was for white
+    // to move without castling rights
+    b->hash ^= zobristCastling[0] ^ zobristCastling[b->castling];
+    if (b->en_passant >= 0)
+        b->hash ^= zobristEnPassant[b->en_passant];
+    if (b->turn == COLOUR_BLACK)
+        b->hash ^= zobristTurn;
+    assert(b->hash == generateChecksum(b));
+    return FEN_OK;
+}
+
+// write a number without printf, returning the end
+static char *writeNumber(char *s, size_t value)
+{
+    char digits[20];
+    size_t count = 0;
+    do
+    {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    while (count)
+        *s++ = digits[--count];
+    return s;
+}
+
+size_t writeFEN(const Board *b, char *buffer)
+{
+    char *s = buffer;
+    for (unsigned row = 0; row < 8; row++)
+    {
+        unsigned empty = 0;
+        for (unsigned file = 0; file < 8; file++)
+        {
+            Piece p = b->tiles[row * 8 + file];
+            if ((p & 0x7f) == PIECE_BLANK)
+            {
+                empty++;
+                continue;
+            }
+            if (empty)
+                *s++ = '0' + empty;
+            empty = 0;
+
+            char letter = pieceLetters[p & 0x7f];
+            *s++ = getColour(p) == COLOUR_WHITE ? letter : letter + ('a' - 'A');
+        }
+        if (empty)
+            *s++ = '0' + empty;
+        if (row < 7)
+            *s++ = '/';
+    }
+
+    *s++ = ' ';
+    *s++ = b->turn == COLOUR_WHITE ? 'w' : 'b';
+
+    *s++ = ' ';
+    if (b->castling == 0)
+        *s++ = '-';
+    for (size_t i = 0; i < 4; i++)
+    {
+        if (b->castling & castleRights[i].right)
+            *s++ = castleRights[i].letter;
+    }
+
+    *s++ = ' ';
+    if (b->en_passant >= 0)
+    {
+        *s++ = 'a' + b->en_passant;
+        *s++ = b->turn == COLOUR_WHITE ? '6' : '3';
+    }
+    else
+        *s++ = '-';
+
+    *s++ = ' ';
+    s    = writeNumber(s, b->halfmoveClock);
+    *s++ = ' ';
+    s    = writeNumber(s, b->moveCount / 2 + 1);
+    *s   = '\0';
+    return s - buffer;
+}
+
+// the whole file, with a terminator. NULL if it can not be read
+static char *readFile(const char *path, size_t *size)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+        return NULL;
+
+    char *text = NULL;
+    long length;
+    if (fseek(file, 0, SEEK_END) == 0 && (length = ftell(file)) >= 0 &&
+        fseek(file, 0, SEEK_SET) == 0)
+    {
+        text = malloc(length + 1);
+        if (text && fread(text, 1, length, file) != (size_t)length)
+        {
+            free(text);
+            text = NULL;
+        }
+    }
+    fclose(file);
+
+    if (text)
+    {
+        text[length] = '\0';
+        *size        = length;
+    }
+    return text;
+}
+
+bool loadEPD(const char *path, PositionSet *set)
+{
+    memset(set, 0, sizeof(PositionSet));
+
+    size_t size;
+    char *text = readFile(path, &size);
+    if (text == NULL)
+        return false;
+
+    // one board per line at most, so the array is allocated once
+    size_t lines = 1;
+    for (const char *s = text; (s = memchr(s, '\n', text + size - s)); s++)
+        lines++;
+    set->boards = malloc(lines * sizeof(Board));
+    if (set->boards == NULL)
+    {
+        free(text);
+        return false;
+    }
+
+    char *line = text;
+    for (size_t number = 1; line < text + size; number++)
+    {
+        char *next = memchr(line, '\n', text + size - line);
+        next       = next ? next : text + size;
+        *next      = '\0';
+
+        const char *start = skipSpaces(line);
+        if (*start != '\0' && *start != '\r' && *start != '#')
+        {
+            // the operations after the position are not needed
+            const char *operations;
+            FenError error =
+                parseFEN(&set->boards[set->count], start, &operations);
+            if (error == FEN_OK)
+                set->count++;
+            else if (set->invalid++ == 0)
+            {
+                set->firstInvalidLine = number;
+                set->firstError       = error;
+            }
+        }
+        line = next + 1;
+    }
+    free(text);
+
+    // give back what blank and invalid lines did not use
+    if (set->count == 0)
+    {
+        free(set->boards);
+        set->boards = NULL;
+    }
+    else if (set->count < lines)
+    {
+        Board *shrunk = realloc(set->boards, set->count * sizeof(Board));
+        if (shrunk)
+            set->boards = shrunk;
+    }
+    return true;
+}
+
+void freePositionSet(PositionSet *set)
+{
+    free(set->boards);
+    set->boards = NULL;
+    set->count  = 0;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+// reading and writing positions in Forsyth-Edwards notation, and loading
+// EPD files of them
+//
+// a FEN has six fields: the pieces from the eighth rank down, the side to
+// move, castling rights, the en passant target tile and the two move
+// clocks. EPD lines have the first four, followed by operations that are
+// not read here. the clocks are optional in both
+
+#include "board.h"
+
+// longest FEN writeFEN produces, with the terminator
+#define FEN_MAX_LENGTH 100
+
+typedef enum
+{
+    FEN_OK = 0,
+    FEN_BAD_PIECE,      // a character that is not a piece, digit or '/'
+    FEN_BAD_BOARD,      // not eight ranks of eight tiles
+    FEN_BAD_KINGS,      // not exactly one king of each colour
+    FEN_BAD_COUNT,      // more than 16 pieces of one colour
+    FEN_BAD_PAWNS,      // a pawn on the first or last rank
+    FEN_BAD_TURN,       // the side to move is not 'w' or 'b'
+    FEN_BAD_CASTLING,   // unknown letters, or a right without its pieces
+    FEN_BAD_EN_PASSANT, // no pawn could have just moved past the tile
+    FEN_BAD_CLOCK,      // the clocks are not numbers, or there is more text
+    FEN_ILLEGAL,        // the side that just moved is in check
+} FenError;
+
+// a short description of an error
+const char *getFenErrorName(FenError error);
+
+// read a FEN into a board. when end is NULL the whole string must be the
+// FEN, otherwise end is set to the text after it, such as EPD operations.
+// nothing is allocated and the board is left empty on failure
+FenError parseFEN(Board *b, const char *fen, const char **end);
+
+// parseFEN with nothing allowed after the FEN
+static inline FenError loadPosition(Board *b, const char *fen)
+{
+    return parseFEN(b, fen, NULL);
+}
+
+// write a board as a FEN. buffer must have room for FEN_MAX_LENGTH
+// characters. returns the length written
+size_t writeFEN(const Board *b, char *buffer);
+
+// every position in an EPD file, in one array
+typedef struct
+{
+    Board *boards;
+    size_t count;
+    // lines that were not valid positions. blank and '#' lines are not
+    // counted
+    size_t invalid;
+    // line number of the first invalid line and why, 0 and FEN_OK if none
+    size_t firstInvalidLine;
+    FenError firstError;
+} PositionSet;
+
+// read a whole EPD file. returns false if it can not be read or the
+// positions do not fit in memory
+bool loadEPD(const char *path, PositionSet *set);
+void freePositionSet(PositionSet *set);
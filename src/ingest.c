@@ -0,0 +1,445 @@
+#include "ingest.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// a piece of the file and what was found in it. the counts, lines and
+// items are from the start of the chunk until it is merged
+typedef struct
+{
+    char *data; // INGEST_CHUNK_SIZE bytes and a terminator
+    size_t length;
+    bool done;
+    bool failed; // ran out of memory for the positions
+
+    uint64_t lines;
+    uint64_t items;
+    uint64_t positions;
+    uint64_t results[4];
+    uint64_t errorCount;
+    IngestError errors[INGEST_MAX_ERRORS];
+
+    // positions written out as text. kept from one chunk to the next and
+    // grown when needed
+    char *output;
+    size_t outputLength;
+    size_t outputCapacity;
+} IngestChunk;
+
+typedef struct
+{
+    const IngestOptions *options;
+    IngestChunk *chunks;
+    size_t chunkCount;
+
+    pthread_mutex_t lock;
+    pthread_cond_t ready; // a chunk is waiting for a worker
+    pthread_cond_t done;  // a worker has finished a chunk
+    // chunks are numbered in file order, chunk n is chunks[n % chunkCount]
+    uint64_t filled;
+    uint64_t taken;
+    bool finished; // no more chunks will be filled
+} IngestQueue;
+
+// each worker replays games on its own boards
+typedef struct
+{
+    IngestQueue *queue;
+    pthread_t handle;
+    PgnReader reader;
+    PgnGame game;
+    Board board;
+} IngestWorker;
+
+static double seconds()
+{
+    struct timespec t;
+    timespec_get(&t, TIME_UTC);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// where the last game starting in the data begins: a tag at the start of a
+// line, after a line that is not a tag. 0 if no game starts after the first
+static size_t findGameStart(const char *data, size_t length)
+{
+    for (size_t p = length; p-- > 0;)
+    {
+        if (data[p] != '[' || (p > 0 && data[p - 1] != '\n'))
+            continue;
+
+        size_t end = p;
+        while (end > 0 && isSpace(data[end - 1]))
+            end--;
+        if (end == 0)
+            return 0;
+        size_t begin = end;
+        while (begin > 0 && data[begin - 1] != '\n')
+            begin--;
+
+        // a tag before it is from the same game, so that tag is looked at
+        // next
+        if (data[begin] != '[')
+            return p;
+        p = begin + 1;
+    }
+    return 0;
+}
+
+// where a chunk ends, so the rest can start the next one. the whole data
+// if there is nowhere to split it
+static size_t findSplit(IngestFormat format, const char *data, size_t length)
+{
+    size_t split = 0;
+    if (format == INGEST_PGN)
+        split = findGameStart(data, length);
+    else
+    {
+        // after the last line break
+        split = length;
+        while (split > 0 && data[split - 1] != '\n')
+            split--;
+    }
+    return split ? split : length;
+}
+
+static void addError(IngestChunk *c, uint64_t line, int code)
+{
+    if (c->errorCount < INGEST_MAX_ERRORS)
+    {
+        c->errors[c->errorCount] = (IngestError){
+            .item = c->items,
+            .line = line,
+            .code = code,
+        };
+    }
+    c->errorCount++;
+}
+
+// make room for one more position in the output
+static bool reserveOutput(IngestChunk *c)
+{
+    const size_t needed = FEN_MAX_LENGTH + 16;
+    if (c->outputLength + needed <= c->outputCapacity)
+        return true;
+
+    size_t capacity = c->outputCapacity ? c->outputCapacity * 2 : 1 << 16;
+    char *output    = realloc(c->output, capacity);
+    if (output == NULL)
+    {
+        c->failed = true;
+        return false;
+    }
+    c->output         = output;
+    c->outputCapacity = capacity;
+    return true;
+}
+
+// the worker's board, with the result of its game when it is from one. as
+// text the result is an EPD c9 operation. returns false if the position
+// has too many pieces to pack, running out of memory sets c->failed
+static bool
+writePosition(IngestWorker *w, IngestChunk *c, const PgnGame *game)
+{
+    if (!reserveOutput(c))
+        return true;
+
+    char *s = c->output + c->outputLength;
+    if (w->queue->options->packed)
+    {
+        PackedPosition packed;
+        if (!packPosition(&w->board, &packed))
+            return false;
+        if (game)
+            packed.result = game->result;
+        memcpy(s, &packed, sizeof(packed));
+        c->outputLength += sizeof(packed);
+        return true;
+    }
+
+    s += writeFEN(&w->board, s);
+    if (game)
+    {
+        s += strlen(strcpy(s, " c9 \""));
+        s += strlen(strcpy(s, getPgnResultName(game->result)));
+        s += strlen(strcpy(s, "\";"));
+    }
+    *s++            = '\n';
+    c->outputLength = s - c->output;
+    return true;
+}
+
+static void parsePgnChunk(IngestWorker *w, IngestChunk *c, bool write)
+{
+    PgnGame *game = &w->game;
+    openPgnMemory(&w->reader, c->data, c->length);
+
+    PgnStatus status;
+    while ((status = readPgnGame(&w->reader, game)) != PGN_END)
+    {
+        c->items++;
+        c->positions += game->moveCount;
+        c->results[game->result]++;
+        if (status != PGN_OK)
+            addError(c, game->errorLine, status);
+
+        // the positions the moves were played from
+        if (write)
+        {
+            Board *b = &w->board;
+            *b       = game->start;
+            for (size_t i = 0; i < game->moveCount && !c->failed; i++)
+            {
+                // moves never add pieces, so the rest would not fit either
+                if (!writePosition(w, c, game))
+                {
+                    addError(c, w->reader.line, PGN_BAD_FEN);
+                    break;
+                }
+                MoveUndo undo;
+                makeMove(b, game->moves[i], &undo);
+            }
+        }
+    }
+    c->lines = w->reader.line - 1;
+}
+
+static void parseEpdChunk(IngestWorker *w, IngestChunk *c, bool write)
+{
+    const char *end = c->data + c->length;
+    for (const char *line = c->data; line < end;)
+    {
+        const char *next = memchr(line, '\n', end - line);
+        next             = next ? next + 1 : end;
+        c->lines += next[-1] == '\n';
+
+        while (line < next && (*line == ' ' || *line == '\t'))
+            line++;
+        if (line < next && !isSpace(*line) && *line != '#')
+        {
+            c->items++;
+            // the operations after the position are not needed
+            const char *operations;
+            FenError error = parseFEN(&w->board, line, &operations);
+            if (error == FEN_OK && write && !writePosition(w, c, NULL))
+                error = FEN_BAD_COUNT;
+            if (error != FEN_OK)
+                addError(c, c->lines + (next[-1] != '\n'), error);
+            else
+                c->positions++;
+        }
+        line = next;
+    }
+}
+
+static void *runWorker(void *data)
+{
+    IngestWorker *w  = data;
+    IngestQueue *q   = w->queue;
+    const bool write = q->options->positions != NULL;
+    for (;;)
+    {
+        pthread_mutex_lock(&q->lock);
+        while (q->taken == q->filled && !q->finished)
+            pthread_cond_wait(&q->ready, &q->lock);
+        if (q->taken == q->filled)
+        {
+            pthread_mutex_unlock(&q->lock);
+            return NULL;
+        }
+        IngestChunk *c = &q->chunks[q->taken++ % q->chunkCount];
+        pthread_mutex_unlock(&q->lock);
+
+        if (q->options->format == INGEST_PGN)
+            parsePgnChunk(w, c, write);
+        else
+            parseEpdChunk(w, c, write);
+
+        pthread_mutex_lock(&q->lock);
+        c->done = true;
+        pthread_cond_signal(&q->done);
+        pthread_mutex_unlock(&q->lock);
+    }
+}
+
+// add a chunk to the totals. its lines and items are counted from the end
+// of the chunks before it
+static bool mergeChunk(IngestStats *stats, IngestChunk *c, FILE *positions)
+{
+    for (size_t i = 0; i < c->errorCount && i < INGEST_MAX_ERRORS; i++)
+    {
+        if (stats->errorCount + i >= INGEST_MAX_ERRORS)
+            break;
+        IngestError e = c->errors[i];
+        e.item += stats->items;
+        e.line += stats->lines;
+        stats->errors[stats->errorCount + i] = e;
+    }
+    stats->errorCount += c->errorCount;
+
+    stats->bytes += c->length;
+    stats->lines += c->lines;
+    stats->items += c->items;
+    stats->positions += c->positions;
+    for (size_t i = 0; i < 4; i++)
+        stats->results[i] += c->results[i];
+
+    if (positions &&
+        fwrite(c->output, 1, c->outputLength, positions) != c->outputLength)
+        return false;
+    return !c->failed;
+}
+
+static void resetChunk(IngestChunk *c)
+{
+    c->done         = false;
+    c->failed       = false;
+    c->lines        = 0;
+    c->items        = 0;
+    c->positions    = 0;
+    c->errorCount   = 0;
+    c->outputLength = 0;
+    memset(c->results, 0, sizeof(c->results));
+}
+
+// read chunks into free slots as long as there are any, merging the oldest
+// once it is done
+static bool
+runIngest(IngestQueue *q, FILE *file, char *carry, IngestStats *stats)
+{
+    const IngestOptions *options = q->options;
+    const double start           = seconds();
+    double lastReport            = start;
+    size_t carryLength           = 0;
+    uint64_t merged              = 0;
+    bool eof                     = false;
+    bool ok                      = true;
+
+    while (!eof || merged < q->filled)
+    {
+        if (!eof && q->filled - merged < q->chunkCount)
+        {
+            // the chunk is not in use, it is only handed out below
+            IngestChunk *c = &q->chunks[q->filled % q->chunkCount];
+            resetChunk(c);
+            memcpy(c->data, carry, carryLength);
+            size_t wanted = INGEST_CHUNK_SIZE - carryLength;
+            size_t read   = fread(c->data + carryLength, 1, wanted, file);
+            size_t length = carryLength + read;
+            eof           = read < wanted;
+
+            size_t split =
+                eof ? length : findSplit(options->format, c->data, length);
+            carryLength = length - split;
+            memcpy(carry, c->data + split, carryLength);
+            c->length      = split;
+            c->data[split] = '\0';
+            if (split == 0)
+                continue;
+
+            pthread_mutex_lock(&q->lock);
+            q->filled++;
+            pthread_cond_signal(&q->ready);
+            pthread_mutex_unlock(&q->lock);
+            continue;
+        }
+
+        IngestChunk *c = &q->chunks[merged % q->chunkCount];
+        pthread_mutex_lock(&q->lock);
+        while (!c->done)
+            pthread_cond_wait(&q->done, &q->lock);
+        pthread_mutex_unlock(&q->lock);
+
+        ok &= mergeChunk(stats, c, options->positions);
+        merged++;
+
+        double now     = seconds();
+        stats->seconds = now - start;
+        if (options->progress && now - lastReport >= 1)
+        {
+            lastReport = now;
+            options->progress(stats, options->progressData);
+        }
+    }
+
+    stats->seconds = seconds() - start;
+    if (options->progress)
+        options->progress(stats, options->progressData);
+    return ok && !ferror(file);
+}
+
+bool ingestFile(
+    const char *path, const IngestOptions *options, IngestStats *stats)
+{
+    memset(stats, 0, sizeof(IngestStats));
+
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+        return false;
+    if (fseek(file, 0, SEEK_END) == 0)
+        stats->totalBytes = ftell(file);
+    rewind(file);
+
+    unsigned threads = options->threads ? options->threads : 1;
+    // enough chunks to keep every worker busy while the oldest is merged
+    IngestQueue q = {
+        .options    = options,
+        .chunkCount = 2 * threads,
+    };
+    q.chunks              = calloc(q.chunkCount, sizeof(IngestChunk));
+    IngestWorker *workers = malloc(threads * sizeof(IngestWorker));
+    char *carry           = malloc(INGEST_CHUNK_SIZE);
+    bool ok               = q.chunks && workers && carry;
+    for (size_t i = 0; ok && i < q.chunkCount; i++)
+    {
+        q.chunks[i].data = malloc(INGEST_CHUNK_SIZE + 1);
+        ok               = q.chunks[i].data != NULL;
+    }
+
+    if (ok)
+    {
+        pthread_mutex_init(&q.lock, NULL);
+        pthread_cond_init(&q.ready, NULL);
+        pthread_cond_init(&q.done, NULL);
+        // every worker takes chunks from the one queue, so the file is read
+        // by as many as could be started
+        unsigned started = 0;
+        for (; started < threads; started++)
+        {
+            IngestWorker *w = &workers[started];
+            w->queue        = &q;
+            if (pthread_create(&w->handle, NULL, runWorker, w) != 0)
+                break;
+        }
+
+        ok = started > 0 && runIngest(&q, file, carry, stats);
+
+        pthread_mutex_lock(&q.lock);
+        q.finished = true;
+        pthread_cond_broadcast(&q.ready);
+        pthread_mutex_unlock(&q.lock);
+        for (unsigned i = 0; i < started; i++)
+            pthread_join(workers[i].handle, NULL);
+
+        pthread_cond_destroy(&q.done);
+        pthread_cond_destroy(&q.ready);
+        pthread_mutex_destroy(&q.lock);
+    }
+
+    for (size_t i = 0; q.chunks && i < q.chunkCount; i++)
+    {
+        free(q.chunks[i].data);
+        free(q.chunks[i].output);
+    }
+    free(q.chunks);
+    free(workers);
+    free(carry);
+    fclose(file);
+    return ok;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+// reading large PGN and EPD files on several threads
+//
+// the calling thread reads the file in chunks, split where a game or line
+// begins, and a pool of workers parses them, each with its own boards.
+// results are merged in file order, so counts, error locations and the
+// positions written out are the same whatever the thread count
+
+#include "fen.h"
+#include "packed.h"
+#include "pgn.h"
+
+#include <stdio.h>
+
+// bytes read at a time. a game longer than this is split and reported as
+// invalid
+#define INGEST_CHUNK_SIZE (1 << 20)
+
+// errors kept in the statistics, the rest are only counted
+#define INGEST_MAX_ERRORS 16
+
+typedef enum
+{
+    INGEST_PGN = 0,
+    INGEST_EPD,
+} IngestFormat;
+
+typedef struct
+{
+    // game or position, counted from 1 in file order
+    uint64_t item;
+    uint64_t line;
+    // a PgnStatus for games, a FenError for positions
+    int code;
+} IngestError;
+
+typedef struct
+{
+    uint64_t bytes;
+    uint64_t totalBytes;
+    uint64_t lines;
+    double seconds;
+
+    // games in a PGN, lines with a position in an EPD
+    uint64_t items;
+    // positions the games' moves were played from, or read from an EPD
+    uint64_t positions;
+    // PGN games by result, indexed by PgnResult
+    uint64_t results[4];
+
+    uint64_t errorCount;
+    IngestError errors[INGEST_MAX_ERRORS];
+} IngestStats;
+
+typedef void (*IngestProgress)(const IngestStats *stats, void *data);
+
+typedef struct
+{
+    IngestFormat format;
+    // workers, 0 is treated as 1. the calling thread only reads and merges
+    unsigned threads;
+
+    // when set every position is written to it as a FEN, in file order.
+    // positions from games are followed by the game's result as an EPD
+    // c9 operation
+    FILE *positions;
+    // write PackedPositions instead, with the game's result in each. only
+    // the records are written, the caller writes the header
+    bool packed;
+
+    // called from the calling thread about once a second, and at the end
+    IngestProgress progress;
+    void *progressData;
+} IngestOptions;
+
+// read a whole file. returns false if it can not be read, there is not
+// enough memory or no worker thread can be started
+bool ingestFile(
+    const char *path, const IngestOptions *options, IngestStats *stats);
@@ -1,17 +1,50 @@
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
 
 #include "board.h"
+#include "book.h"
+#include "fen.h"
 
 #include "render/render.h"
 
-int main(
-    __attribute_maybe_unused__ int argc, __attribute_maybe_unused__ char **argv)
+// plies played from a book before the players take over
+#define BOOK_PLIES 8
+
+// start from one of the book's openings, so games do not all begin the same
+// way. move promotes to a queen, which no book opening this short needs
+static void playBookOpening(Board *b, const char *path)
+{
+    OpeningBook book;
+    if (!openBook(path, &book))
+    {
+        printf("Failed to open book '%s'\n", path);
+        return;
+    }
+
+    srand(time(NULL));
+    for (size_t i = 0; i < BOOK_PLIES; i++)
+    {
+        uint64_t random = (uint64_t)rand() << 32 ^ rand();
+        PackedMove m    = pickBookMove(&book, b, random);
+        if (m == MOVE_NONE)
+            break;
+        Move squares = {getMoveFrom(m), getMoveTo(m)};
+        move(b, squares);
+    }
+    closeBook(&book);
+}
+
+// chess.x86_64 [book]
+int main(int argc, char **argv)
 {
     Board b = createBoard();
 
     loadPosition(
         &b, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    if (argc > 1)
+        playBookOpening(&b, argv[1]);
 
     BoardRender *render = create_board_render(
         "/home/kael/Code/Chess/textures/board.png",
@@ -0,0 +1,183 @@
+#include "movepick.h"
+#include "position.h"
+
+#include <stdlib.h>
+
+void initMovePicker(
+    MovePicker *p,
+    Board *b,
+    PackedMove hashMove,
+    const PackedMove *killers,
+    const HistoryTable *history)
+{
+    p->board       = b;
+    p->history     = history;
+    p->hashMove    = hashMove;
+    p->killers[0]  = killers ? killers[0] : MOVE_NONE;
+    p->killers[1]  = killers ? killers[1] : MOVE_NONE;
+    p->noisyOnly   = false;
+    p->stage       = PICK_HASH;
+    p->killerIndex = 0;
+    p->moves.count = 0;
+    p->next        = 0;
+    p->badCount    = 0;
+    p->badNext     = 0;
+}
+
+void initNoisyPicker(MovePicker *p, Board *b)
+{
+    initMovePicker(p, b, MOVE_NONE, NULL, NULL);
+    p->noisyOnly = true;
+    p->stage     = PICK_GENERATE_NOISY;
+}
+
+// most valuable victim first, taken by the least valuable attacker.
+// promotions count as capturing the piece promoted to
+static int scoreNoisy(const Board *b, PackedMove m)
+{
+    Piece attacker = b->tiles[getMoveFrom(m)] & 0x7f;
+    Piece victim   = getMoveFlags(m) == MOVE_EN_PASSANT
+                         ? PIECE_PAWN
+                         : b->tiles[getMoveTo(m)] & 0x7f;
+
+    int score = victim * 8 - attacker;
+    if (isPromotion(m))
+        score += (getPromotionPiece(m) - PIECE_PAWN) * 8;
+    return score;
+}
+
+static void scoreMoves(MovePicker *p, size_t first)
+{
+    const Board *b = p->board;
+    for (size_t i = first; i < p->moves.count; i++)
+    {
+        PackedMove m = p->moves.moves[i];
+        if (getMoveKind(m) == GENERATE_NOISY)
+            p->scores[i] = scoreNoisy(b, m);
+        else if (p->history)
+            p->scores[i] =
+                (*p->history)[b->turn][getMoveFrom(m)][getMoveTo(m)];
+        else
+            p->scores[i] = 0;
+    }
+}
+
+// move the best scored remaining move to the front of what is left. a full
+// sort would be wasted on the moves after a cutoff
+static PackedMove pickBest(MovePicker *p)
+{
+    size_t best = p->next;
+    for (size_t i = p->next + 1; i < p->moves.count; i++)
+    {
+        if (p->scores[i] > p->scores[best])
+            best = i;
+    }
+
+    PackedMove m            = p->moves.moves[best];
+    int score               = p->scores[best];
+    p->moves.moves[best]    = p->moves.moves[p->next];
+    p->scores[best]         = p->scores[p->next];
+    p->moves.moves[p->next] = m;
+    p->scores[p->next]      = score;
+    p->next++;
+    return m;
+}
+
+// a capture can only lose material when the piece making it is worth more
+// than the one taken, only then is the exchange played out
+static bool isLosing(Board *b, PackedMove m)
+{
+    Piece attacker = b->tiles[getMoveFrom(m)] & 0x7f;
+    Piece victim   = b->tiles[getMoveTo(m)] & 0x7f;
+    if (!isPromotion(m) && pieceValues[attacker] <= pieceValues[victim])
+        return false;
+    return staticExchangeEval(b, m) < 0;
+}
+
+static bool isKiller(const MovePicker *p, PackedMove m)
+{
+    return m == p->killers[0] || m == p->killers[1];
+}
+
+PackedMove nextMove(MovePicker *p)
+{
+    PackedMove m;
+    switch (p->stage)
+    {
+    case PICK_HASH:
+        p->stage = PICK_GENERATE_NOISY;
+        if (p->hashMove != MOVE_NONE && isLegalMove(p->board, p->hashMove))
+            return p->hashMove;
+        // fall through
+
+    case PICK_GENERATE_NOISY:
+        generateMoveKind(p->board, &p->moves, GENERATE_NOISY);
+        scoreMoves(p, 0);
+        p->stage = PICK_NOISY;
+        // fall through
+
+    case PICK_NOISY:
+        while (p->next < p->moves.count)
+        {
+            m = pickBest(p);
+            if (m == p->hashMove)
+                continue;
+            if (isLosing(p->board, m))
+                p->badNoisy[p->badCount++] = m;
+            else
+                return m;
+        }
+        p->stage = p->noisyOnly ? PICK_DONE : PICK_KILLERS;
+        if (p->noisyOnly)
+            return MOVE_NONE;
+        // fall through
+
+    case PICK_KILLERS:
+        // a killer is a quiet move, the same move in this position may not
+        // be legal or may now capture something
+        while (p->killerIndex < 2)
+        {
+            m = p->killers[p->killerIndex++];
+            if (m != MOVE_NONE && m != p->hashMove &&
+                getMoveKind(m) == GENERATE_QUIET && isLegalMove(p->board, m))
+                return m;
+        }
+        p->stage = PICK_GENERATE_QUIET;
+        // fall through
+
+    case PICK_GENERATE_QUIET:
+    {
+        size_t first = p->moves.count;
+        generateMoveKind(p->board, &p->moves, GENERATE_QUIET);
+        scoreMoves(p, first);
+        p->stage = PICK_QUIET;
+    }
+        // fall through
+
+    case PICK_QUIET:
+        while (p->next < p->moves.count)
+        {
+            m = pickBest(p);
+            if (m != p->hashMove && !isKiller(p, m))
+                return m;
+        }
+        p->stage = PICK_BAD_NOISY;
+        // fall through
+
+    case PICK_BAD_NOISY:
+        if (p->badNext < p->badCount)
+            return p->badNoisy[p->badNext++];
+        p->stage = PICK_DONE;
+        // fall through
+
+    case PICK_DONE: break;
+    }
+    return MOVE_NONE;
+}
+
+void updateHistory(HistoryTable *history, Colour c, PackedMove m, int bonus)
+{
+    int16_t *entry = &(*history)[c][getMoveFrom(m)][getMoveTo(m)];
+    // the closer to the limit the less a bonus moves it, so it never passes
+    *entry += bonus - *entry * abs(bonus) / HISTORY_MAX;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+// hands out a position's moves one at a time, best first by a guess, and
+// only generates each kind of move once it is needed. a cutoff on the hash
+// move or a capture never generates the quiet moves at all. captures
+// losing material by static exchange evaluation come last
+
+#include "board.h"
+#include "moves.h"
+
+// the largest magnitude a history score reaches
+#define HISTORY_MAX 16384
+
+// how often each quiet move has caused a cutoff, indexed by the colour
+// moving and the from and to tiles
+typedef int16_t HistoryTable[2][64][64];
+
+typedef enum
+{
+    PICK_HASH,
+    PICK_GENERATE_NOISY,
+    PICK_NOISY,
+    PICK_KILLERS,
+    PICK_GENERATE_QUIET,
+    PICK_QUIET,
+    PICK_BAD_NOISY,
+    PICK_DONE,
+} PickStage;
+
+typedef struct
+{
+    Board *board;
+    const HistoryTable *history;
+    PackedMove hashMove;
+    PackedMove killers[2];
+    bool noisyOnly;
+
+    PickStage stage;
+    size_t killerIndex;
+    MoveList moves;
+    int scores[MAX_MOVES];
+    size_t next; // first move in the list not handed out yet
+
+    // captures that lose material by exchange, tried after the quiet moves
+    PackedMove badNoisy[MAX_MOVES];
+    size_t badCount;
+    size_t badNext;
+} MovePicker;
+
+// pick every move. the hash move and killers are tried before the moves
+// are generated, if they are legal. killers and history may be NULL
+void initMovePicker(
+    MovePicker *p,
+    Board *b,
+    PackedMove hashMove,
+    const PackedMove *killers,
+    const HistoryTable *history);
+
+// pick only captures and promotions, for the quiescence search. the ones
+// losing material by exchange are left out
+void initNoisyPicker(MovePicker *p, Board *b);
+
+// get the next move, or MOVE_NONE once there are none left
+PackedMove nextMove(MovePicker *p);
+
+// reward a quiet move that caused a cutoff, or punish one that did not, by
+// bonus. scores saturate towards HISTORY_MAX
+void updateHistory(HistoryTable *history, Colour c, PackedMove m, int bonus);
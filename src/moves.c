@@ -1,438 +1,809 @@
 #include "moves.h"
+#include "attacks.h"
 #include "board.h"
+#include "zobrist.h"
 
 #include <assert.h>
-#include <math.h>
-#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-bool withinBoard(int8_t position);
-void getLegalColumn(Board *b, Position p, Position *moves, size_t *moveIndex);
-void getLegalRow(
-    Board *b, Position position, Position *moves, size_t *moveIndex);
-void getLegalDiagonals(
-    Board *b, Position position, Position *moves, size_t *moveIndex);
-void getLegalKnightMoves(
-    Board *b, Position position, Position *moves, size_t *moveIndex);
-void getLegalKingMoves(
-    Board *b, Position position, Position *moves, size_t *moveIndex);
-void getLegalPawnMoves(
-    Board *b, Position position, Position *moves, size_t *moveIndex);
-
-Colour isCheckInternal(
-    Board *b,
-    Colour colour,
-    Move m,
-    Position *legalMoves,
-    size_t legalMoveCount);
+bool moveLeavesCheck(Board *b, Colour colour, Move m);
 
-size_t getLegalMoves(Board *b, Position p, Position *moves)
+// the tiles a king and rook move between when castling
+typedef struct
 {
-    size_t movesIndex = 0;
-
-    Piece piece = getPiece(b, p);
+    uint8_t right;
+    unsigned flag;
+    Position king, kingTo;
+    Position rook, rookTo;
+} Castle;
+
+// white castles first, then black. king side before queen side
+static const Castle castles[4] = {
+    {CASTLE_WHITE_KING, MOVE_CASTLE_KING, 60, 62, 63, 61},
+    {CASTLE_WHITE_QUEEN, MOVE_CASTLE_QUEEN, 60, 58, 56, 59},
+    {CASTLE_BLACK_KING, MOVE_CASTLE_KING, 4, 6, 7, 5},
+    {CASTLE_BLACK_QUEEN, MOVE_CASTLE_QUEEN, 4, 2, 0, 3},
+};
+
+// castling rights lost when a piece moves from or to a tile
+static const uint8_t castlingLost[64] = {
+    [0]  = CASTLE_BLACK_QUEEN,
+    [4]  = CASTLE_BLACK_KING | CASTLE_BLACK_QUEEN,
+    [7]  = CASTLE_BLACK_KING,
+    [56] = CASTLE_WHITE_QUEEN,
+    [60] = CASTLE_WHITE_KING | CASTLE_WHITE_QUEEN,
+    [63] = CASTLE_WHITE_KING,
+};
+
+static void
+addMove(MoveList *list, Position from, Position to, unsigned flags)
+{
+    assert(list->count < MAX_MOVES);
+    list->moves[list->count++] = packMove(from, to, flags);
+}
 
-    // don't allow moves for wrong colour
-    if (getColour(piece) != b->turn)
-        return 0;
-    switch (piece & 0x7f)
+// add a move for every target tile, marking the ones holding an enemy
+static void
+addTargets(MoveList *list, Position from, Bitboard targets, Bitboard enemies)
+{
+    while (targets)
     {
-    case PIECE_PAWN:
-        getLegalPawnMoves(b, p, moves, &movesIndex);
-        // handle en passant
-        break;
-    case PIECE_BISHOP: getLegalDiagonals(b, p, moves, &movesIndex); break;
-    case PIECE_ROOK:
-        getLegalColumn(b, p, moves, &movesIndex);
-        getLegalRow(b, p, moves, &movesIndex);
-        break;
-    case PIECE_KNIGHT: getLegalKnightMoves(b, p, moves, &movesIndex); break;
-    case PIECE_KING: getLegalKingMoves(b, p, moves, &movesIndex); break;
-    default:
-        getLegalColumn(b, p, moves, &movesIndex);
-        getLegalRow(b, p, moves, &movesIndex);
-        getLegalDiagonals(b, p, moves, &movesIndex);
-        break;
+        Position to = bitboardPopFirst(&targets);
+        addMove(
+            list,
+            from,
+            to,
+            bitboardTest(enemies, to) ? MOVE_CAPTURE : MOVE_QUIET);
     }
+}
 
-    Colour colour = getColour(getPiece(b, p));
-    assert(colour != COLOUR_NONE);
-    for (size_t i = 0; i < movesIndex; i++)
+// add a pawn move, expanding it into the four promotions on the last row
+static void addPawnMove(
+    MoveList *list, Position from, Position to, unsigned flags, Colour c)
+{
+    if (to / 8 != (c == COLOUR_WHITE ? 0 : 7))
     {
-        Move m = {p, moves[i]};
-        if (isCheckInternal(b, colour, m, moves, movesIndex) == colour)
-            moves[i] = UINT8_MAX;
+        addMove(list, from, to, flags);
+        return;
+    }
+    for (int piece = PIECE_QUEEN; piece >= PIECE_KNIGHT; piece--)
+    {
+        unsigned promotion = MOVE_PROMOTION | (piece - PIECE_KNIGHT);
+        addMove(list, from, to, flags | promotion);
     }
-    return movesIndex;
 }
 
-bool move(Board *b, Move m)
+// get the pieces of colour c that are the only thing between their king and
+// an enemy slider
+static Bitboard getPinned(Board *b, Colour c, Position king)
 {
-    assert(m[1] < 64 && m[0] < 64);
-    Position moves[32];
-    size_t moveCount = getLegalMoves(b, m[0], moves);
+    const Bitboard enemies  = b->colours[otherColour(c)];
+    const Bitboard occupied = getOccupied(b);
+    const Bitboard queens   = b->pieces[PIECE_QUEEN];
+
+    Bitboard snipers =
+        ((rookAttacks(king, BITBOARD_EMPTY) &
+          (b->pieces[PIECE_ROOK] | queens)) |
+         (bishopAttacks(king, BITBOARD_EMPTY) &
+          (b->pieces[PIECE_BISHOP] | queens))) &
+        enemies;
+
+    Bitboard pinned = BITBOARD_EMPTY;
+    while (snipers)
+    {
+        Bitboard blockers =
+            betweenSquares(king, bitboardPopFirst(&snipers)) & occupied;
+        if (bitboardCount(blockers) == 1 && (blockers & b->colours[c]))
+            pinned |= blockers;
+    }
+    return pinned;
+}
 
-    // ensure the move is legal
-    bool found = false;
-    for (size_t i = 0; i < moveCount; i++)
+static void generatePawnMoves(
+    Board *b,
+    MoveList *list,
+    MoveKind kind,
+    Bitboard fromMask,
+    Position king,
+    Bitboard targets,
+    Bitboard pinned)
+{
+    const Colour us         = b->turn;
+    const Bitboard enemies  = b->colours[otherColour(us)];
+    const Bitboard occupied = getOccupied(b);
+    const int forward       = us == COLOUR_WHITE ? -8 : 8;
+    const unsigned startRow = us == COLOUR_WHITE ? 6 : 1;
+    const unsigned lastRow  = us == COLOUR_WHITE ? 0 : 7;
+
+    Bitboard pawns = getPieces(b, PIECE_PAWN, us) & fromMask;
+    while (pawns)
     {
-        if (moves[i] < 64 && moves[i] == m[1])
+        Position from = bitboardPopFirst(&pawns);
+
+        // a pinned pawn may only move along the line to its king
+        Bitboard allowed = targets;
+        if (bitboardTest(pinned, from))
+            allowed &= lineThrough(king, from);
+
+        // pushes are quiet unless they promote
+        Position to = from + forward;
+        MoveKind pushKind =
+            to / 8 == lastRow ? GENERATE_NOISY : GENERATE_QUIET;
+        if (!bitboardTest(occupied, to))
+        {
+            if ((kind & pushKind) && bitboardTest(allowed, to))
+                addPawnMove(list, from, to, MOVE_QUIET, us);
+
+            Position twice = to + forward;
+            if ((kind & GENERATE_QUIET) && from / 8 == startRow &&
+                !bitboardTest(occupied, twice) && bitboardTest(allowed, twice))
+                addMove(list, from, twice, MOVE_DOUBLE_PAWN);
+        }
+
+        if (!(kind & GENERATE_NOISY))
+            continue;
+        Bitboard captures = pawnAttacks(us, from) & enemies & allowed;
+        while (captures)
         {
-            found = true;
-            break;
+            to = bitboardPopFirst(&captures);
+            addPawnMove(list, from, to, MOVE_CAPTURE, us);
         }
     }
-    if (found == false)
-        return false;
 
-    // get data for special move testing
-    Piece movedPiece     = getPiece(b, m[0]);
-    Piece capturedPiece  = getPiece(b, m[1]);
-    Colour colour        = getColour(movedPiece);
-    int move             = m[1] - m[0];
-    int startingPosition = m[0];
-    int endingPosition   = m[1];
-
-    // move the piece
-    movePiece(b, m[0], m[1]);
-    b->lastMove[0] = m[0];
-    b->lastMove[1] = m[1];
-    b->moveCount++;
-    b->turn = b->turn == COLOUR_WHITE ? COLOUR_BLACK : COLOUR_WHITE;
+    if (b->en_passant < 0 || !(kind & GENERATE_NOISY))
+        return;
 
-    // check for special moves
+    // en passant captures remove two pieces from one row, which can expose
+    // the king in ways the pin mask misses. test them by moving the pieces
+    Position target   = (us == COLOUR_WHITE ? 2 : 5) * 8 + b->en_passant;
+    Position captured = target - forward;
+    if (!bitboardTest(getPieces(b, PIECE_PAWN, otherColour(us)), captured) ||
+        bitboardTest(occupied, target))
+        return;
 
-    // double pawn moves
-    if ((movedPiece & 0x7f) == PIECE_PAWN && abs(move) == 16)
+    Bitboard capturers = pawnAttacks(otherColour(us), target) &
+                         getPieces(b, PIECE_PAWN, us) & fromMask;
+    while (capturers)
     {
-        b->en_passant = startingPosition % 8;
+        Position from = bitboardPopFirst(&capturers);
+        Bitboard after =
+            (occupied ^ bitboardSquare(from) ^ bitboardSquare(captured)) |
+            bitboardSquare(target);
+        if (king >= 64 || !(getAttackers(b, king, after) & enemies &
+                             ~bitboardSquare(captured)))
+            addMove(list, from, target, MOVE_EN_PASSANT);
     }
+}
 
-    // en passant captures
-    if ((movedPiece & 0x7f) == PIECE_PAWN &&
-        endingPosition % 8 == b->en_passant &&
-        endingPosition / 8 == (colour == COLOUR_WHITE ? 2 : 5))
+static void generateCastles(Board *b, MoveList *list)
+{
+    const Colour us         = b->turn;
+    const Bitboard enemies  = b->colours[otherColour(us)];
+    const Bitboard occupied = getOccupied(b);
+
+    const size_t first = us == COLOUR_WHITE ? 0 : 2;
+    for (size_t i = first; i < first + 2; i++)
     {
-        // delete captured pawn
-        unsigned captureTile =
-            endingPosition + (colour == COLOUR_WHITE ? 8 : -8);
-        assert(getColour(getPiece(b, captureTile)) != colour);
-        setPiece(b, captureTile, PIECE_BLANK);
+        const Castle *c = &castles[i];
+        if (!(b->castling & c->right) ||
+            !bitboardTest(getPieces(b, PIECE_ROOK, us), c->rook) ||
+            (betweenSquares(c->king, c->rook) & occupied))
+            continue;
+
+        // the king may not pass through or land on an attacked tile
+        Bitboard path = betweenSquares(c->king, c->kingTo) |
+                        bitboardSquare(c->kingTo);
+        bool safe = true;
+        while (path && safe)
+            safe = !(getAttackers(b, bitboardPopFirst(&path), occupied) &
+                     enemies);
+        if (safe)
+            addMove(list, c->king, c->kingTo, c->flag);
     }
-
-    return true;
 }
 
-//
-// helpers
-//
-
-// is check overload if no move needed
-Colour isCheck(Board *b, Colour colour)
+// add the legal moves of one kind made by the pieces on fromMask
+static void
+generate(Board *b, MoveList *list, MoveKind kind, Bitboard fromMask)
 {
-    Move m = {255, 255};
-    return isCheckM(b, colour, m);
-}
+    const Colour us         = b->turn;
+    const Bitboard friends  = b->colours[us];
+    const Bitboard enemies  = b->colours[otherColour(us)];
+    const Bitboard occupied = friends | enemies;
+
+    // the tiles pieces other than pawns may move to for the kind
+    Bitboard kindTargets = BITBOARD_EMPTY;
+    if (kind & GENERATE_NOISY)
+        kindTargets |= enemies;
+    if (kind & GENERATE_QUIET)
+        kindTargets |= ~occupied;
+
+    // positions without a king are allowed, nothing is ever in check in them
+    Bitboard kingTile = getPieces(b, PIECE_KING, us);
+    Position king     = kingTile ? bitboardFirst(kingTile) : UINT8_MAX;
+    Bitboard checkers = BITBOARD_EMPTY;
+    Bitboard pinned   = BITBOARD_EMPTY;
+
+    if (kingTile)
+    {
+        checkers = getAttackers(b, king, occupied) & enemies;
+        pinned   = getPinned(b, us, king);
+
+        // the king is taken off the board so it cannot hide behind itself
+        Bitboard kingTargets = kingTile & fromMask
+                                   ? kingAttacks(king) & kindTargets
+                                   : BITBOARD_EMPTY;
+        while (kingTargets)
+        {
+            Position to = bitboardPopFirst(&kingTargets);
+            if (!(getAttackers(b, to, occupied ^ kingTile) & enemies))
+                addMove(
+                    list,
+                    king,
+                    to,
+                    bitboardTest(enemies, to) ? MOVE_CAPTURE : MOVE_QUIET);
+        }
 
-// check if the king of colour c is in check. If so, it will return the
-// colour of the piece being checked. If the other king is checked, it will
-// return that king instead.
-Colour isCheckM(Board *b, Colour colour, Move m)
-{
-    Position legalMoves[32];
-    size_t legalMoveCount;
-    legalMoveCount = getLegalMoves(b, m[0], legalMoves);
-    return isCheckInternal(b, colour, m, legalMoves, legalMoveCount);
-}
+        // only the king can escape a double check
+        if (bitboardCount(checkers) > 1)
+            return;
+    }
 
-Colour isCheckInternal(
-    Board *b,
-    Colour colour,
-    Move m,
-    Position *legalMoves,
-    size_t legalMoveCount)
-{
+    // when in check other pieces must capture the checker or block it
+    Bitboard targets = ~friends;
+    if (checkers)
+        targets = betweenSquares(king, bitboardFirst(checkers)) | checkers;
+    else if (kingTile & fromMask && kind & GENERATE_QUIET)
+        generateCastles(b, list);
+
+    generatePawnMoves(b, list, kind, fromMask, king, targets, pinned);
+    targets &= kindTargets;
 
-    // make the move being tested, and store it so it can be moved back
-    // this will probably cause a ton of problems in the future
-    Piece capturedPiece = PIECE_BLANK;
-    if (m[0] < 64 && m[1] < 64)
+    // pinned knights can never move
+    Bitboard knights = getPieces(b, PIECE_KNIGHT, us) & fromMask & ~pinned;
+    while (knights)
     {
-        capturedPiece = getPiece(b, m[1]);
-        movePiece(b, m[0], m[1]);
+        Position from = bitboardPopFirst(&knights);
+        addTargets(list, from, knightAttacks(from) & targets, enemies);
     }
 
-    Colour checkedColour = COLOUR_NONE;
-    // iterate through the entire board to see if any pieces have check
-    for (Position position = 0; position < 64 && checkedColour != colour;
-         position++)
+    const Bitboard queens = b->pieces[PIECE_QUEEN];
+    Bitboard diagonal =
+        (b->pieces[PIECE_BISHOP] | queens) & friends & fromMask;
+    while (diagonal)
     {
-        Piece movedPiece = getPiece(b, position);
-        // if the moved piece is not blank get the legal moves and see if any of
-        // them check
-        if ((movedPiece & 0x7f) != PIECE_BLANK)
-        {
-            for (size_t move = 0; move < legalMoveCount; move++)
-            {
-                // if a legal move attacks a king it is check
-                // do not need to check colour, as moving onto the own colour
-                // king is not allowed by the rules
-                Piece attackedPiece = getPiece(b, legalMoves[move]);
-                if ((attackedPiece & 0x7f) == PIECE_KING)
-                {
-                    Colour c = getColour(attackedPiece);
-                    if (c == colour)
-                        checkedColour = c;
-                    else if (checkedColour == COLOUR_NONE)
-                        checkedColour = c;
-                }
-            }
-        }
+        Position from    = bitboardPopFirst(&diagonal);
+        Bitboard attacks = bishopAttacks(from, occupied) & targets;
+        if (bitboardTest(pinned, from))
+            attacks &= lineThrough(king, from);
+        addTargets(list, from, attacks, enemies);
     }
 
-    // move piece back
-    if (m[0] < 64 && m[1] < 64)
+    Bitboard straight = (b->pieces[PIECE_ROOK] | queens) & friends & fromMask;
+    while (straight)
     {
-        movePiece(b, m[1], m[0]);
-        setPiece(b, m[1], capturedPiece);
+        Position from    = bitboardPopFirst(&straight);
+        Bitboard attacks = rookAttacks(from, occupied) & targets;
+        if (bitboardTest(pinned, from))
+            attacks &= lineThrough(king, from);
+        addTargets(list, from, attacks, enemies);
     }
+}
+
+size_t generateMoves(Board *b, MoveList *list)
+{
+    list->count = 0;
+    generate(b, list, GENERATE_ALL, BITBOARD_FULL);
+    return list->count;
+}
 
-    return checkedColour;
+size_t generateMoveKind(Board *b, MoveList *list, MoveKind kind)
+{
+    generate(b, list, kind, BITBOARD_FULL);
+    return list->count;
 }
-// assert a position is within the board
-bool withinBoard(int8_t position) { return position >= 0 && position < 64; }
 
-// if true stop looping
-// check if a piece has hit another piece while moving
-bool checkIntercept(
-    Board *b, Position p, Colour c, Position *moves, size_t *moveIndex)
+bool isLegalMove(Board *b, PackedMove m)
+{
+    Piece piece = b->tiles[getMoveFrom(m)];
+    if ((piece & 0x7f) == PIECE_BLANK || getColour(piece) != b->turn)
+        return false;
+
+    MoveList list;
+    list.count = 0;
+    generate(b, &list, getMoveKind(m), bitboardSquare(getMoveFrom(m)));
+    for (size_t i = 0; i < list.count; i++)
+    {
+        if (list.moves[i] == m)
+            return true;
+    }
+    return false;
+}
+
+size_t getLegalMoves(Board *b, Position p, Position *moves)
 {
     Piece piece = getPiece(b, p);
-    if (piece == PIECE_BLANK)
+
+    // don't allow moves for wrong colour
+    if ((piece & 0x7f) == PIECE_BLANK || getColour(piece) != b->turn)
+        return 0;
+
+    MoveList list;
+    generateMoves(b, &list);
+
+    size_t movesIndex = 0;
+    for (size_t i = 0; i < list.count; i++)
     {
+        PackedMove m = list.moves[i];
+        // promotions are listed once per final tile, as a queen
+        if (getMoveFrom(m) != p ||
+            (isPromotion(m) && getPromotionPiece(m) != PIECE_QUEEN))
+            continue;
         if (moves)
-            moves[*moveIndex] = p;
-        *moveIndex += 1;
-        return false;
+            moves[movesIndex] = getMoveTo(m);
+        movesIndex++;
     }
-    else
+    return movesIndex;
+}
+
+bool move(Board *b, Move m)
+{
+    assert(m[1] < 64 && m[0] < 64);
+    MoveList list;
+    generateMoves(b, &list);
+
+    // ensure the move is legal. pawns reaching the last row become queens
+    for (size_t i = 0; i < list.count; i++)
     {
-        // if a capture is legal, add it then exit the loop
-        if (getColour(piece) != c)
+        PackedMove legal = list.moves[i];
+        if (getMoveFrom(legal) == m[0] && getMoveTo(legal) == m[1] &&
+            (!isPromotion(legal) || getPromotionPiece(legal) == PIECE_QUEEN))
         {
-            if (moves)
-                moves[*moveIndex] = p;
-            *moveIndex += 1;
+            MoveUndo undo;
+            makeMove(b, legal, &undo);
+            return true;
         }
-        return true;
     }
+    return false;
 }
 
-void getLegalColumn(Board *b, Position p, Position *moves, size_t *moveIndex)
+void moveToString(PackedMove m, char *buffer)
 {
-    assert(b && moveIndex);
-    assert(*moveIndex < 64);
-    Colour pieceColour = getColour(getPiece(b, p));
-
-    // count moves down
-    for (uint8_t i = p + 8; withinBoard(i); i += 8)
+    const Position tiles[2] = {getMoveFrom(m), getMoveTo(m)};
+    for (size_t i = 0; i < 2; i++)
     {
-        if (checkIntercept(b, i, pieceColour, moves, moveIndex))
-            break;
+        // row 0 is the eighth rank
+        *buffer++ = 'a' + tiles[i] % 8;
+        *buffer++ = '8' - tiles[i] / 8;
     }
+    if (isPromotion(m))
+        *buffer++ = "nbrq"[getPromotionPiece(m) - PIECE_KNIGHT];
+    *buffer = '\0';
+}
 
-    // count moves up
-    for (int8_t i = p - 8; withinBoard(i); i -= 8)
+PackedMove parseMove(Board *b, const char *text)
+{
+    MoveList list;
+    generateMoves(b, &list);
+    for (size_t i = 0; i < list.count; i++)
     {
-        if (checkIntercept(b, i, pieceColour, moves, moveIndex))
-            break;
+        char name[6];
+        moveToString(list.moves[i], name);
+        if (strcmp(name, text) == 0)
+            return list.moves[i];
     }
+    return MOVE_NONE;
 }
 
-void getLegalRow(
-    Board *b, Position position, Position *moves, size_t *moveIndex)
+// piece letters in algebraic notation, indexed by piece type
+static const char sanLetters[] = "  NBRQK";
+
+void moveToSan(Board *b, PackedMove m, char *buffer)
 {
-    assert(b && moveIndex);
-    assert(*moveIndex < 64);
-    Colour pieceColour = getColour(getPiece(b, position));
-
-    // count moves right
-    for (int8_t i = position + 1;
-         position % 8 != 7 && i % 8 != 0 && withinBoard(i);
-         i++)
+    const Position from  = getMoveFrom(m);
+    const Position to    = getMoveTo(m);
+    const unsigned flags = getMoveFlags(m);
+    const Piece piece    = getPiece(b, from) & 0x7f;
+    char *s              = buffer;
+
+    if (flags == MOVE_CASTLE_KING || flags == MOVE_CASTLE_QUEEN)
+    {
+        const char *name = flags == MOVE_CASTLE_KING ? "O-O" : "O-O-O";
+        while (*name)
+            *s++ = *name++;
+    }
+    else
     {
-        if (checkIntercept(b, i, pieceColour, moves, moveIndex))
-            break;
+        if (piece == PIECE_PAWN)
+        {
+            if (isCapture(m))
+                *s++ = 'a' + from % 8;
+        }
+        else
+        {
+            *s++ = sanLetters[piece];
+
+            // name the starting file, or rank, or both, if another piece of
+            // the same type can reach the tile
+            MoveList list;
+            list.count = 0;
+            generate(b, &list, GENERATE_ALL, getPieces(b, piece, b->turn));
+            bool ambiguous = false, sameFile = false, sameRow = false;
+            for (size_t i = 0; i < list.count; i++)
+            {
+                Position other = getMoveFrom(list.moves[i]);
+                if (getMoveTo(list.moves[i]) != to || other == from)
+                    continue;
+                ambiguous = true;
+                sameFile |= other % 8 == from % 8;
+                sameRow |= other / 8 == from / 8;
+            }
+            if (ambiguous && (!sameFile || sameRow))
+                *s++ = 'a' + from % 8;
+            if (ambiguous && sameFile)
+                *s++ = '8' - from / 8;
+        }
+
+        if (isCapture(m))
+            *s++ = 'x';
+        *s++ = 'a' + to % 8;
+        *s++ = '8' - to / 8;
+        if (isPromotion(m))
+        {
+            *s++ = '=';
+            *s++ = sanLetters[getPromotionPiece(m)];
+        }
     }
 
-    // count moves left
-    for (int8_t i = position - 1;
-         (position % 8 != 0) && (i % 8 != 7) && withinBoard(i);
-         i--)
+    MoveUndo undo;
+    makeMove(b, m, &undo);
+    if (isKingAttacked(b, b->turn))
     {
-        if (checkIntercept(b, i, pieceColour, moves, moveIndex))
-            break;
+        MoveList replies;
+        *s++ = generateMoves(b, &replies) ? '+' : '#';
     }
+    unmakeMove(b, m, &undo);
+    *s = '\0';
 }
 
-void getLegalDiagonals(
-    Board *b, Position position, Position *moves, size_t *moveIndex)
+// the piece type for an algebraic notation letter, PIECE_BLANK if it is not
+// one
+static Piece getSanPiece(char c)
 {
-    Colour pieceColour = getColour(getPiece(b, position)); // down and right
+    const char *letter = c ? strchr(sanLetters + 2, c) : NULL;
+    return letter ? letter - sanLetters : PIECE_BLANK;
+}
 
-    // down right
-    for (int8_t i = position + 9; i % 8 != 0 && withinBoard(i); i += 9)
+PackedMove parseSan(Board *b, const char *text)
+{
+    // the move ends before any check mark or annotation
+    size_t length = strcspn(text, "+#!? \t\r\n");
+    const char *s = text;
+    const char *e = text + length;
+
+    // only the moves of the piece named are generated
+    MoveList list;
+    list.count = 0;
+
+    // castling is written with letters or, in some files, zeros
+    unsigned castle = MOVE_QUIET;
+    if (length == 3 && (!strncmp(s, "O-O", 3) || !strncmp(s, "0-0", 3)))
+        castle = MOVE_CASTLE_KING;
+    else if (length == 5 &&
+             (!strncmp(s, "O-O-O", 5) || !strncmp(s, "0-0-0", 5)))
+        castle = MOVE_CASTLE_QUEEN;
+    if (castle != MOVE_QUIET)
     {
-        if (checkIntercept(b, i, pieceColour, moves, moveIndex))
-            break;
+        generate(
+            b, &list, GENERATE_QUIET, getPieces(b, PIECE_KING, b->turn));
+        for (size_t i = 0; i < list.count; i++)
+        {
+            if (getMoveFlags(list.moves[i]) == castle)
+                return list.moves[i];
+        }
+        return MOVE_NONE;
     }
-    // up left
-    for (int8_t i = position - 9; i % 8 != 7 && withinBoard(i); i -= 9)
+
+    Piece piece = PIECE_PAWN;
+    if (s < e && getSanPiece(*s) != PIECE_BLANK)
+        piece = getSanPiece(*s++);
+
+    Piece promotion = PIECE_BLANK;
+    if (e - s > 2 && getSanPiece(e[-1]) != PIECE_BLANK &&
+        getSanPiece(e[-1]) != PIECE_KING)
     {
-        if (checkIntercept(b, i, pieceColour, moves, moveIndex))
-            break;
+        promotion = getSanPiece(*--e);
+        if (e[-1] == '=')
+            e--;
     }
-    // down left
-    for (int8_t i = position + 7; i % 8 != 7 && withinBoard(i); i += 7)
+
+    if (e - s < 2 || e[-2] < 'a' || e[-2] > 'h' || e[-1] < '1' || e[-1] > '8')
+        return MOVE_NONE;
+    const Position to = ('8' - e[-1]) * 8 + (e[-2] - 'a');
+    e -= 2;
+
+    // whatever is left is where the piece starts from, and a capture mark
+    int fromFile = -1, fromRow = -1;
+    for (; s < e; s++)
     {
-        if (checkIntercept(b, i, pieceColour, moves, moveIndex))
-            break;
+        if (*s >= 'a' && *s <= 'h')
+            fromFile = *s - 'a';
+        else if (*s >= '1' && *s <= '8')
+            fromRow = '8' - *s;
+        else if (*s != 'x')
+            return MOVE_NONE;
     }
-    // up right
-    for (int8_t i = position - 7; i % 8 != 0 && withinBoard(i); i -= 7)
+
+    generate(b, &list, GENERATE_ALL, getPieces(b, piece, b->turn));
+    PackedMove found = MOVE_NONE;
+    for (size_t i = 0; i < list.count; i++)
     {
-        if (checkIntercept(b, i, pieceColour, moves, moveIndex))
-            break;
+        PackedMove m  = list.moves[i];
+        Position from = getMoveFrom(m);
+        if (getMoveTo(m) != to || (fromFile >= 0 && from % 8 != fromFile) ||
+            (fromRow >= 0 && from / 8 != fromRow) ||
+            (isPromotion(m) ? getPromotionPiece(m) : PIECE_BLANK) !=
+                promotion)
+            continue;
+        // more than one match is ambiguous
+        if (found != MOVE_NONE)
+            return MOVE_NONE;
+        found = m;
     }
+    return found;
 }
 
-// check if a square can be moved to, and if so add it to the move list
-bool handleMoveSquare(
-    Board *b,
-    Position position,
-    Position *moves,
-    size_t *moveIndex,
-    Colour pieceColour,
-    uint8_t move)
+// the tile holding the pawn taken by an en passant capture
+static Position enPassantVictim(Position to, Colour colour)
 {
-    // ensure move is within board, and does not wrap corner
-    if (!withinBoard(position + move))
-        return false;
-
-    Piece p = getPiece(b, position + move);
-    if (p == PIECE_BLANK || getColour(p) != pieceColour)
-    {
-        moves[*moveIndex] = position + move;
-        *moveIndex += 1;
-        return true;
-    }
-    return false;
+    return to + (colour == COLOUR_WHITE ? 8 : -8);
 }
 
-void getLegalKnightMoves(
-    Board *b, Position position, Position *moves, size_t *moveIndex)
+static const Castle *getCastle(Colour colour, unsigned flags)
 {
+    return &castles
+        [(colour == COLOUR_WHITE ? 0 : 2) + (flags == MOVE_CASTLE_QUEEN)];
+}
 
-    Colour pieceColour = getColour(getPiece(b, position));
-
-    // left 2
-    if (position % 8 != 0 && position % 8 != 1)
-    {
-        handleMoveSquare(b, position, moves, moveIndex, pieceColour, -10);
-        handleMoveSquare(b, position, moves, moveIndex, pieceColour, 6);
-    }
-    if (position % 8 != 0)
+void makeMove(Board *b, PackedMove m, MoveUndo *undo)
+{
+    const Position from  = getMoveFrom(m);
+    const Position to    = getMoveTo(m);
+    const unsigned flags = getMoveFlags(m);
+    const Piece moved    = getPiece(b, from);
+    const Colour colour  = getColour(moved);
+
+    undo->captured      = getPiece(b, to);
+    undo->en_passant    = b->en_passant;
+    undo->castling      = b->castling;
+    undo->halfmoveClock = b->halfmoveClock;
+    undo->lastMove[0]   = b->lastMove[0];
+    undo->lastMove[1]   = b->lastMove[1];
+    undo->hash          = b->hash;
+
+    // en passant captures take a pawn behind the final tile
+    if (flags == MOVE_EN_PASSANT)
     {
-        handleMoveSquare(b, position, moves, moveIndex, pieceColour, -17);
-        handleMoveSquare(b, position, moves, moveIndex, pieceColour, 15);
+        Position victim = enPassantVictim(to, colour);
+        undo->captured  = getPiece(b, victim);
+        setPiece(b, victim, PIECE_BLANK);
     }
-    // right
-    if (position % 8 != 7 && position % 8 != 6)
+
+    movePiece(b, from, to);
+
+    if (isPromotion(m))
     {
-        handleMoveSquare(b, position, moves, moveIndex, pieceColour, 10);
-        handleMoveSquare(b, position, moves, moveIndex, pieceColour, -6);
+        Piece promoted = getPromotionPiece(m);
+        setColour(&promoted, colour);
+        setPiece(b, to, promoted);
     }
-    if (position % 8 != 7)
+
+    if (flags == MOVE_CASTLE_KING || flags == MOVE_CASTLE_QUEEN)
     {
-        handleMoveSquare(b, position, moves, moveIndex, pieceColour, -15);
-        handleMoveSquare(b, position, moves, moveIndex, pieceColour, 17);
+        const Castle *c = getCastle(colour, flags);
+        movePiece(b, c->rook, c->rookTo);
     }
+
+    if ((moved & 0x7f) == PIECE_PAWN || isCapture(m))
+        b->halfmoveClock = 0;
+    else
+        b->halfmoveClock++;
+
+    // setPiece has hashed the pieces, the rest of the state is hashed here
+    b->hash ^= zobristCastling[b->castling];
+    if (b->en_passant >= 0)
+        b->hash ^= zobristEnPassant[b->en_passant];
+
+    b->castling &= ~(castlingLost[from] | castlingLost[to]);
+    b->en_passant = flags == MOVE_DOUBLE_PAWN ? from % 8 : -1;
+
+    b->hash ^= zobristCastling[b->castling] ^ zobristTurn;
+    if (b->en_passant >= 0)
+        b->hash ^= zobristEnPassant[b->en_passant];
+
+    b->lastMove[0] = from;
+    b->lastMove[1] = to;
+    b->moveCount++;
+    b->turn = otherColour(b->turn);
 }
 
-void getLegalKingMoves(
-    Board *b, Position position, Position *moves, size_t *moveIndex)
+void unmakeMove(Board *b, PackedMove m, const MoveUndo *undo)
 {
-    const Piece p = getPiece(b, position);
-    assert((p & 0x7f) == PIECE_KING);
-
-    Colour colour = getColour(p);
-    handleMoveSquare(b, position, moves, moveIndex, colour, -8);
-    handleMoveSquare(b, position, moves, moveIndex, colour, 8);
-    // left
-    if (position % 8)
+    const Position from  = getMoveFrom(m);
+    const Position to    = getMoveTo(m);
+    const unsigned flags = getMoveFlags(m);
+
+    b->turn = otherColour(b->turn);
+    b->moveCount--;
+    const Colour colour = b->turn;
+
+    if (isPromotion(m))
     {
-        handleMoveSquare(b, position, moves, moveIndex, colour, -1);
-        handleMoveSquare(b, position, moves, moveIndex, colour, -9);
-        handleMoveSquare(b, position, moves, moveIndex, colour, 7);
+        Piece pawn = PIECE_PAWN;
+        setColour(&pawn, colour);
+        setPiece(b, to, pawn);
     }
-    // right
-    if (position % 8 != 7)
+
+    if (flags == MOVE_CASTLE_KING || flags == MOVE_CASTLE_QUEEN)
     {
-        handleMoveSquare(b, position, moves, moveIndex, colour, 1);
-        handleMoveSquare(b, position, moves, moveIndex, colour, 9);
-        handleMoveSquare(b, position, moves, moveIndex, colour, -7);
+        const Castle *c = getCastle(colour, flags);
+        movePiece(b, c->rookTo, c->rook);
     }
 
-    // castling
-    if (colour == COLOUR_WHITE && b->w_castle_k)
-        ;
+    movePiece(b, to, from);
+    if (flags == MOVE_EN_PASSANT)
+        setPiece(b, enPassantVictim(to, colour), undo->captured);
+    else
+        setPiece(b, to, undo->captured);
+
+    b->en_passant    = undo->en_passant;
+    b->castling      = undo->castling;
+    b->halfmoveClock = undo->halfmoveClock;
+    b->lastMove[0]   = undo->lastMove[0];
+    b->lastMove[1]   = undo->lastMove[1];
+    b->hash          = undo->hash;
+}
+
+void makeNullMove(Board *b, MoveUndo *undo)
+{
+    undo->captured      = PIECE_BLANK;
+    undo->en_passant    = b->en_passant;
+    undo->castling      = b->castling;
+    undo->halfmoveClock = b->halfmoveClock;
+    undo->lastMove[0]   = b->lastMove[0];
+    undo->lastMove[1]   = b->lastMove[1];
+    undo->hash          = b->hash;
+
+    if (b->en_passant >= 0)
+        b->hash ^= zobristEnPassant[b->en_passant];
+    b->hash ^= zobristTurn;
+
+    b->en_passant    = -1;
+    b->halfmoveClock = 0;
+    b->moveCount++;
+    b->turn = otherColour(b->turn);
+}
+
+void unmakeNullMove(Board *b, const MoveUndo *undo)
+{
+    b->turn = otherColour(b->turn);
+    b->moveCount--;
+
+    b->en_passant    = undo->en_passant;
+    b->halfmoveClock = undo->halfmoveClock;
+    b->hash          = undo->hash;
 }
 
-void getLegalPawnMoves(
-    Board *b, Position position, Position *moves, size_t *moveIndex)
+// work out the flags for a move given only by its tiles. the move does not
+// need to be legal
+static PackedMove packTiles(Board *b, Move m)
 {
-    Piece p = getPiece(b, position);
-    assert((p & 0x7f) == PIECE_PAWN);
-
-    Colour c = getColour(p);
-    assert(c != COLOUR_NONE);
-    int direction;
-    if (c == COLOUR_WHITE)
-        direction = -1;
-    if (c == COLOUR_BLACK)
-        direction = 1;
-
-    // if there is no piece in front of the pawn, it is a legal move
-    const int forward = 8 * direction;
-    if (withinBoard(position + forward) &&
-        getPiece(b, position + forward) == PIECE_BLANK)
-        handleMoveSquare(b, position, moves, moveIndex, c, forward);
-    // if there is a piece to one side of the pawn, consider the move.
-    const int side1 = 9 * direction;
-    if (withinBoard(position + side1) &&
-        getPiece(b, position + side1) != PIECE_BLANK)
-        handleMoveSquare(b, position, moves, moveIndex, c, side1);
-    // if there is a piece to the other side, consider it a move
-    const int side2 = 7 * direction;
-    if (withinBoard(position + side2) &&
-        getPiece(b, position + side2) != PIECE_BLANK)
-        handleMoveSquare(b, position, moves, moveIndex, c, side2);
-
-    // move twice on first move
-    if ((direction == -1 && position / 8 == 6) ||
-        (direction == 1 && position / 8 == 1))
-        handleMoveSquare(b, position, moves, moveIndex, c, 16 * direction);
-
-    // en passant captures
-    int file             = position % 8;
-    unsigned captureTile = (direction == -1 ? 2 : 5) * 8 + b->en_passant;
-    bool correctFile     = abs(file - b->en_passant) == 1;
-    bool correctRank     = (direction == 1 && position / 8 == 4) ||
-                       (direction == -1 && position / 8 == 3);
-    bool unobstructed = (getPiece(b, captureTile) & 0x7f) == PIECE_BLANK;
-    if (correctFile && correctRank && unobstructed)
+    const Piece moved    = getPiece(b, m[0]);
+    const bool capturing = getPiece(b, m[1]) != PIECE_BLANK;
+    const int distance   = abs(m[1] - m[0]);
+    unsigned flags       = capturing ? MOVE_CAPTURE : MOVE_QUIET;
+
+    switch (moved & 0x7f)
     {
-        handleMoveSquare(
-            b, position, moves, moveIndex, c, captureTile - position);
+    case PIECE_PAWN:
+        if (distance == 16)
+            flags = MOVE_DOUBLE_PAWN;
+        else if (m[0] % 8 != m[1] % 8 && !capturing)
+            flags = MOVE_EN_PASSANT;
+        else if (m[1] / 8 == 0 || m[1] / 8 == 7)
+            flags |= MOVE_PROMOTION | (PIECE_QUEEN - PIECE_KNIGHT);
+        break;
+    case PIECE_KING:
+        if (distance == 2)
+            flags = m[1] > m[0] ? MOVE_CASTLE_KING : MOVE_CASTLE_QUEEN;
+        break;
     }
+    return packMove(m[0], m[1], flags);
+}
+
+Bitboard getAttackers(Board *b, Position square, Bitboard occupied)
+{
+    assert(square < 64);
+    const Bitboard queens = b->pieces[PIECE_QUEEN];
+    return (pawnAttacks(COLOUR_BLACK, square) &
+            getPieces(b, PIECE_PAWN, COLOUR_WHITE)) |
+           (pawnAttacks(COLOUR_WHITE, square) &
+            getPieces(b, PIECE_PAWN, COLOUR_BLACK)) |
+           (knightAttacks(square) & b->pieces[PIECE_KNIGHT]) |
+           (kingAttacks(square) & b->pieces[PIECE_KING]) |
+           (bishopAttacks(square, occupied) &
+            (b->pieces[PIECE_BISHOP] | queens)) |
+           (rookAttacks(square, occupied) & (b->pieces[PIECE_ROOK] | queens));
+}
+
+// check if any piece of colour byColour attacks a tile. works backwards
+// from the tile: a knight on the tile would attack exactly the tiles
+// enemy knights can attack it from, and likewise for the other pieces
+bool isSquareAttacked(Board *b, Position square, Colour byColour)
+{
+    assert(square < 64);
+    const Bitboard attackers = b->colours[byColour];
+    const Bitboard occupied  = getOccupied(b);
+
+    // pawns capture towards the opposite side to the way they are seen from
+    if (pawnAttacks(otherColour(byColour), square) & attackers &
+        b->pieces[PIECE_PAWN])
+        return true;
+    if (knightAttacks(square) & attackers & b->pieces[PIECE_KNIGHT])
+        return true;
+    if (kingAttacks(square) & attackers & b->pieces[PIECE_KING])
+        return true;
+
+    const Bitboard queens = b->pieces[PIECE_QUEEN];
+    if (bishopAttacks(square, occupied) & attackers &
+        (b->pieces[PIECE_BISHOP] | queens))
+        return true;
+    return rookAttacks(square, occupied) & attackers &
+           (b->pieces[PIECE_ROOK] | queens);
+}
+
+// check if the king of a colour is attacked. a missing king is never
+// attacked
+bool isKingAttacked(Board *b, Colour colour)
+{
+    Bitboard king = getPieces(b, PIECE_KING, colour);
+    return king &&
+           isSquareAttacked(b, bitboardFirst(king), otherColour(colour));
+}
+
+// is check overload if no move needed
+Colour isCheck(Board *b, Colour colour)
+{
+    Move m = {255, 255};
+    return isCheckM(b, colour, m);
+}
+
+// check if the king of colour c is in check. If so, it will return the
+// colour of the piece being checked. If the other king is checked, it will
+// return that king instead.
+Colour isCheckM(Board *b, Colour colour, Move m)
+{
+    if (moveLeavesCheck(b, colour, m))
+        return colour;
+    if (moveLeavesCheck(b, otherColour(colour), m))
+        return otherColour(colour);
+    return COLOUR_NONE;
+}
+
+// make the move being tested, see if the king of colour is attacked
+// afterwards and then move everything back. moves off the board test the
+// current position
+bool moveLeavesCheck(Board *b, Colour colour, Move m)
+{
+    if (m[0] >= 64 || m[1] >= 64)
+        return isKingAttacked(b, colour);
+
+    PackedMove packed = packTiles(b, m);
+    MoveUndo undo;
+    makeMove(b, packed, &undo);
+    bool attacked = isKingAttacked(b, colour);
+    unmakeMove(b, packed, &undo);
+
+    return attacked;
 }
@@ -4,10 +4,143 @@
 
 typedef Position Move[2];
 
+// a move packed into 16 bits. bits 0-5 hold the starting tile, bits 6-11
+// the final tile and bits 12-15 the MOVE_ flags below
+typedef uint16_t PackedMove;
+
+enum
+{
+    MOVE_QUIET        = 0,
+    MOVE_DOUBLE_PAWN  = 1,
+    MOVE_CASTLE_KING  = 2,
+    MOVE_CASTLE_QUEEN = 3,
+    MOVE_CAPTURE      = 4,
+    MOVE_EN_PASSANT   = 5,
+    // promotions store the new piece as an offset from PIECE_KNIGHT in the
+    // low two bits, and may be combined with MOVE_CAPTURE
+    MOVE_PROMOTION = 8,
+};
+
+// never generated, used to mark the absence of a move
+#define MOVE_NONE ((PackedMove)0)
+
+// no position has more than 218 legal moves
+#define MAX_MOVES 256
+
+typedef struct
+{
+    PackedMove moves[MAX_MOVES];
+    size_t count;
+} MoveList;
+
+static inline PackedMove packMove(Position from, Position to, unsigned flags)
+{
+    return (PackedMove)(from | (to << 6) | (flags << 12));
+}
+
+static inline Position getMoveFrom(PackedMove m) { return m & 0x3f; }
+
+static inline Position getMoveTo(PackedMove m) { return (m >> 6) & 0x3f; }
+
+static inline unsigned getMoveFlags(PackedMove m) { return m >> 12; }
+
+static inline bool isCapture(PackedMove m)
+{
+    return getMoveFlags(m) & MOVE_CAPTURE;
+}
+
+static inline bool isPromotion(PackedMove m)
+{
+    return getMoveFlags(m) & MOVE_PROMOTION;
+}
+
+// get the piece type a pawn promotes to, the move must be a promotion
+static inline Piece getPromotionPiece(PackedMove m)
+{
+    return PIECE_KNIGHT + (getMoveFlags(m) & 3);
+}
+
+// write a move in coordinate notation, such as e2e4 or e7e8q.
+// buffer must have room for 6 characters
+void moveToString(PackedMove m, char *buffer);
+// read a move in coordinate notation. returns MOVE_NONE if it is not a
+// legal move in the position
+PackedMove parseMove(Board *b, const char *text);
+
+// longest move in standard algebraic notation, such as exd8=Q#, with the
+// terminator
+#define SAN_MAX_LENGTH 8
+
+// write a legal move in standard algebraic notation, such as Nbd2, exd8=Q
+// or O-O+. buffer must have room for SAN_MAX_LENGTH characters
+void moveToSan(Board *b, PackedMove m, char *buffer);
+// read a move in standard algebraic notation. check marks and annotations
+// such as !? may follow it. returns MOVE_NONE if it is not legal or is
+// ambiguous in the position
+PackedMove parseSan(Board *b, const char *text);
+
+// the board state a move destroys, kept so the move can be taken back
+typedef struct
+{
+    Piece captured;
+    int8_t en_passant;
+    uint8_t castling;
+    unsigned halfmoveClock;
+    Position lastMove[2];
+    uint64_t hash;
+} MoveUndo;
+
+// play a legal move on the board, saving what is needed to undo it
+void makeMove(Board *b, PackedMove m, MoveUndo *undo);
+// take back the last move played by makeMove
+void unmakeMove(Board *b, PackedMove m, const MoveUndo *undo);
+
+// pass the turn without moving, for null move pruning. the side to move
+// must not be in check. the halfmove clock restarts, a pass is not a real
+// move and the positions before it do not count as repetitions
+void makeNullMove(Board *b, MoveUndo *undo);
+void unmakeNullMove(Board *b, const MoveUndo *undo);
+
+// generate every legal move for the side to move
+// returns the number of moves, which are also stored in list
+size_t generateMoves(Board *b, MoveList *list);
+
+// the moves generateMoveKind lists
+typedef enum
+{
+    GENERATE_NOISY = 1, // captures, en passant and promotions
+    GENERATE_QUIET = 2, // everything else, castling included
+    GENERATE_ALL   = GENERATE_NOISY | GENERATE_QUIET,
+} MoveKind;
+
+// the moves of one kind a move belongs to
+static inline MoveKind getMoveKind(PackedMove m)
+{
+    return isCapture(m) || isPromotion(m) ? GENERATE_NOISY : GENERATE_QUIET;
+}
+
+// generate the legal moves of one kind, adding them to the end of list so
+// the kinds can be generated one after the other.
+// returns the new number of moves in the list
+size_t generateMoveKind(Board *b, MoveList *list, MoveKind kind);
+
+// check if a move, such as one from the transposition table, is legal in
+// the position. only the moving piece's moves are generated
+bool isLegalMove(Board *b, PackedMove m);
+
 // get legal moves for a piece on a square
 // returns the number of allowed moves
 // if moves is not NULL, the legal moves will be stored in *moves.
 size_t getLegalMoves(Board *b, Position p, Position *moves);
+
+// get every piece of both colours attacking a tile, with sliders blocked by
+// the occupied tiles given
+Bitboard getAttackers(Board *b, Position square, Bitboard occupied);
+// check if a tile is attacked by any piece of colour byColour
+bool isSquareAttacked(Board *b, Position square, Colour byColour);
+// check if the king of colour is attacked
+bool isKingAttacked(Board *b, Colour colour);
+
 Colour isCheckM(Board *b, Colour colour, Move m);
 Colour isCheck(Board *b, Colour colour);
 
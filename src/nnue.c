@@ -0,0 +1,375 @@
+#include "nnue.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NNUE_X86
+#endif
+
+typedef struct
+{
+    int16_t featureBias[NNUE_HIDDEN];
+    int16_t featureWeights[NNUE_INPUTS][NNUE_HIDDEN];
+    int32_t hiddenBias[NNUE_LAYER1];
+    int8_t hiddenWeights[NNUE_LAYER1][2 * NNUE_HIDDEN];
+    int32_t outputBias;
+    int8_t outputWeights[NNUE_LAYER1];
+} __attribute__((aligned(32))) Network;
+
+static Network network;
+static bool networkLoaded = false;
+
+// clip 16 bit sums to 0..127
+typedef void (*ActivateKernel)(const int16_t *in, uint8_t *out, size_t count);
+// out[o] = bias[o] + sum of in[i] * weights[o][i]. the input count is a
+// multiple of 32
+typedef void (*AffineKernel)(
+    const uint8_t *in,
+    const int8_t *weights,
+    const int32_t *bias,
+    int32_t *out,
+    size_t inputs,
+    size_t outputs);
+
+static void activateScalar(const int16_t *in, uint8_t *out, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        out[i] = in[i] < 0 ? 0 : in[i] > 127 ? 127 : in[i];
+}
+
+static void affineScalar(
+    const uint8_t *in,
+    const int8_t *weights,
+    const int32_t *bias,
+    int32_t *out,
+    size_t inputs,
+    size_t outputs)
+{
+    for (size_t o = 0; o < outputs; o++)
+    {
+        int32_t sum = bias[o];
+        for (size_t i = 0; i < inputs; i++)
+            sum += in[i] * weights[o * inputs + i];
+        out[o] = sum;
+    }
+}
+
+#ifdef NNUE_X86
+
+// the inputs are at most 127, so a pair of products always fits in the 16
+// bit lanes of maddubs without saturating
+
+__attribute__((target("sse4.1"))) static void
+activateSse41(const int16_t *in, uint8_t *out, size_t count)
+{
+    const __m128i max = _mm_set1_epi16(127);
+    for (size_t i = 0; i < count; i += 16)
+    {
+        __m128i a =
+            _mm_min_epi16(_mm_loadu_si128((const __m128i *)&in[i]), max);
+        __m128i b =
+            _mm_min_epi16(_mm_loadu_si128((const __m128i *)&in[i + 8]), max);
+        _mm_storeu_si128((__m128i *)&out[i], _mm_packus_epi16(a, b));
+    }
+}
+
+__attribute__((target("sse4.1"))) static void affineSse41(
+    const uint8_t *in,
+    const int8_t *weights,
+    const int32_t *bias,
+    int32_t *out,
+    size_t inputs,
+    size_t outputs)
+{
+    const __m128i ones = _mm_set1_epi16(1);
+    for (size_t o = 0; o < outputs; o++)
+    {
+        const int8_t *row = &weights[o * inputs];
+        __m128i sum       = _mm_setzero_si128();
+        for (size_t i = 0; i < inputs; i += 16)
+        {
+            __m128i x       = _mm_loadu_si128((const __m128i *)&in[i]);
+            __m128i w       = _mm_loadu_si128((const __m128i *)&row[i]);
+            __m128i product = _mm_maddubs_epi16(x, w);
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(product, ones));
+        }
+        sum    = _mm_hadd_epi32(sum, sum);
+        sum    = _mm_hadd_epi32(sum, sum);
+        out[o] = bias[o] + _mm_cvtsi128_si32(sum);
+    }
+}
+
+__attribute__((target("avx2"))) static void
+activateAvx2(const int16_t *in, uint8_t *out, size_t count)
+{
+    const __m256i max = _mm256_set1_epi16(127);
+    for (size_t i = 0; i < count; i += 32)
+    {
+        __m256i a =
+            _mm256_min_epi16(_mm256_loadu_si256((const __m256i *)&in[i]), max);
+        __m256i b = _mm256_min_epi16(
+            _mm256_loadu_si256((const __m256i *)&in[i + 16]), max);
+        // packing works within each 128 bit half, put the quarters back in
+        // order afterwards
+        __m256i packed = _mm256_packus_epi16(a, b);
+        packed         = _mm256_permute4x64_epi64(packed, 0xd8);
+        _mm256_storeu_si256((__m256i *)&out[i], packed);
+    }
+}
+
+__attribute__((target("avx2"))) static void affineAvx2(
+    const uint8_t *in,
+    const int8_t *weights,
+    const int32_t *bias,
+    int32_t *out,
+    size_t inputs,
+    size_t outputs)
+{
+    const __m256i ones = _mm256_set1_epi16(1);
+    for (size_t o = 0; o < outputs; o++)
+    {
+        const int8_t *row = &weights[o * inputs];
+        __m256i sum       = _mm256_setzero_si256();
+        for (size_t i = 0; i < inputs; i += 32)
+        {
+            __m256i x       = _mm256_loadu_si256((const __m256i *)&in[i]);
+            __m256i w       = _mm256_loadu_si256((const __m256i *)&row[i]);
+            __m256i product = _mm256_maddubs_epi16(x, w);
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(product, ones));
+        }
+        __m128i half = _mm_add_epi32(
+            _mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        half   = _mm_hadd_epi32(half, half);
+        half   = _mm_hadd_epi32(half, half);
+        out[o] = bias[o] + _mm_cvtsi128_si32(half);
+    }
+}
+
+#endif
+
+static NnueKernel kernel       = NNUE_KERNEL_SCALAR;
+static ActivateKernel activate = activateScalar;
+static AffineKernel affine     = affineScalar;
+
+static bool isKernelSupported(NnueKernel k)
+{
+    switch (k)
+    {
+    case NNUE_KERNEL_SCALAR: return true;
+#ifdef NNUE_X86
+    case NNUE_KERNEL_SSE41: return __builtin_cpu_supports("sse4.1");
+    case NNUE_KERNEL_AVX2: return __builtin_cpu_supports("avx2");
+#endif
+    default: return false;
+    }
+}
+
+bool selectNnueKernel(NnueKernel k)
+{
+    if (!isKernelSupported(k))
+        return false;
+
+    kernel = k;
+    switch (k)
+    {
+#ifdef NNUE_X86
+    case NNUE_KERNEL_SSE41:
+        activate = activateSse41;
+        affine   = affineSse41;
+        break;
+    case NNUE_KERNEL_AVX2:
+        activate = activateAvx2;
+        affine   = affineAvx2;
+        break;
+#endif
+    default:
+        activate = activateScalar;
+        affine   = affineScalar;
+        break;
+    }
+    return true;
+}
+
+NnueKernel getNnueKernel() { return kernel; }
+
+const char *getNnueKernelName(NnueKernel k)
+{
+    switch (k)
+    {
+    case NNUE_KERNEL_SCALAR: return "scalar";
+    case NNUE_KERNEL_SSE41: return "sse4.1";
+    case NNUE_KERNEL_AVX2: return "avx2";
+    }
+    return "unknown";
+}
+
+// use the best kernel the processor has
+__attribute__((constructor)) static void initNnueKernel()
+{
+    if (!selectNnueKernel(NNUE_KERNEL_AVX2))
+        selectNnueKernel(NNUE_KERNEL_SSE41);
+}
+
+// read count little endian numbers of size bytes each
+static bool readBlock(FILE *file, void *data, size_t size, size_t count)
+{
+    if (fread(data, size, count, file) != count)
+        return false;
+
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    uint8_t *bytes = data;
+    for (size_t i = 0; i < count; i++, bytes += size)
+    {
+        for (size_t j = 0; j < size / 2; j++)
+        {
+            uint8_t byte        = bytes[j];
+            bytes[j]            = bytes[size - 1 - j];
+            bytes[size - 1 - j] = byte;
+        }
+    }
+#endif
+    return true;
+}
+
+// a whole array of numbers
+#define readArray(file, array)                                                 \
+    readBlock(file, array, sizeof(*(array)), sizeof(array) / sizeof(*(array)))
+
+bool loadNetwork(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+        return false;
+    bool valid = readNetwork(file);
+    fclose(file);
+    return valid;
+}
+
+bool readNetwork(FILE *file)
+{
+    char magic[4];
+    uint32_t header[4];
+    bool valid = readArray(file, magic) && readArray(file, header) &&
+                 memcmp(magic, "CNUE", 4) == 0 && header[0] == NNUE_VERSION &&
+                 header[1] == NNUE_INPUTS && header[2] == NNUE_HIDDEN &&
+                 header[3] == NNUE_LAYER1;
+
+    // read into a copy so a bad file leaves the loaded network alone
+    static Network loaded;
+    valid = valid && readArray(file, loaded.featureBias) &&
+            readBlock(
+                file,
+                loaded.featureWeights,
+                sizeof(loaded.featureWeights[0][0]),
+                NNUE_INPUTS * NNUE_HIDDEN) &&
+            readArray(file, loaded.hiddenBias) &&
+            readBlock(
+                file,
+                loaded.hiddenWeights,
+                sizeof(loaded.hiddenWeights[0][0]),
+                NNUE_LAYER1 * 2 * NNUE_HIDDEN) &&
+            readBlock(file, &loaded.outputBias, sizeof(loaded.outputBias), 1) &&
+            readArray(file, loaded.outputWeights) && fgetc(file) == EOF;
+
+    if (valid)
+    {
+        network       = loaded;
+        networkLoaded = true;
+    }
+    return valid;
+}
+
+bool isNetworkLoaded() { return networkLoaded; }
+
+// the first layer input for a piece, as seen by one side. each side sees
+// the board as if it were white, with its own pieces first
+static size_t featureIndex(Colour perspective, Piece p, Position tile)
+{
+    size_t relative = getColour(p) == perspective ? 0 : 1;
+    size_t flipped  = perspective == COLOUR_WHITE ? tile : tile ^ 56;
+    return (relative * 6 + (p & 0x7f) - PIECE_PAWN) * 64 + flipped;
+}
+
+void refreshAccumulator(NnueAccumulator *acc, const Board *b)
+{
+    for (Colour c = COLOUR_BLACK; c <= COLOUR_WHITE; c++)
+        memcpy(acc->values[c], network.featureBias, sizeof(acc->values[c]));
+
+    for (Position tile = 0; tile < 64; tile++)
+    {
+        if ((b->tiles[tile] & 0x7f) != PIECE_BLANK)
+            updateAccumulator(acc, tile, PIECE_BLANK, b->tiles[tile]);
+    }
+}
+
+// restrict lets the compiler vectorise these without checking for overlap
+static void addRow(int16_t *restrict values, const int16_t *restrict row)
+{
+    for (size_t i = 0; i < NNUE_HIDDEN; i++)
+        values[i] += row[i];
+}
+
+static void subtractRow(int16_t *restrict values, const int16_t *restrict row)
+{
+    for (size_t i = 0; i < NNUE_HIDDEN; i++)
+        values[i] -= row[i];
+}
+
+void updateAccumulator(
+    NnueAccumulator *acc, Position tile, Piece old, Piece piece)
+{
+    for (Colour c = COLOUR_BLACK; c <= COLOUR_WHITE; c++)
+    {
+        if ((old & 0x7f) != PIECE_BLANK)
+        {
+            subtractRow(
+                acc->values[c],
+                network.featureWeights[featureIndex(c, old, tile)]);
+        }
+        if ((piece & 0x7f) != PIECE_BLANK)
+        {
+            addRow(
+                acc->values[c],
+                network.featureWeights[featureIndex(c, piece, tile)]);
+        }
+    }
+}
+
+int evaluateNetwork(const Board *b)
+{
+    const NnueAccumulator *acc = b->accumulator;
+
+    // the side to move's half comes first
+    uint8_t input[2 * NNUE_HIDDEN] __attribute__((aligned(32)));
+    activate(acc->values[b->turn], input, NNUE_HIDDEN);
+    activate(
+        acc->values[otherColour(b->turn)], input + NNUE_HIDDEN, NNUE_HIDDEN);
+
+    int32_t sums[NNUE_LAYER1];
+    affine(
+        input,
+        &network.hiddenWeights[0][0],
+        network.hiddenBias,
+        sums,
+        2 * NNUE_HIDDEN,
+        NNUE_LAYER1);
+
+    uint8_t hidden[NNUE_LAYER1] __attribute__((aligned(32)));
+    for (size_t i = 0; i < NNUE_LAYER1; i++)
+    {
+        int32_t s = sums[i] >> NNUE_WEIGHT_SHIFT;
+        hidden[i] = s < 0 ? 0 : s > 127 ? 127 : s;
+    }
+
+    int32_t output;
+    affine(
+        hidden,
+        network.outputWeights,
+        &network.outputBias,
+        &output,
+        NNUE_LAYER1,
+        1);
+    return output / NNUE_OUTPUT_SCALE;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+// efficiently updatable neural network evaluation. the first layer sums a
+// weight row for every piece on the board, once from each side's point of
+// view. that sum, the accumulator, is kept up to date by setPiece as pieces
+// move, so only the two small layers after it are computed per evaluation
+//
+// network files are little endian, and converted as they are loaded:
+//   char magic[4]                      "CNUE"
+//   uint32_t version, inputs, hidden, layer1
+//   int16_t featureBias[hidden]
+//   int16_t featureWeights[inputs][hidden]
+//   int32_t hiddenBias[layer1]
+//   int8_t hiddenWeights[layer1][2 * hidden]
+//   int32_t outputBias
+//   int8_t outputWeights[layer1]
+//
+// the accumulator is clipped to 0..127 before the hidden layer, whose sums
+// are shifted down by NNUE_WEIGHT_SHIFT and clipped again. the output is
+// divided by NNUE_OUTPUT_SCALE to give centipawns for the side to move
+
+#include "board.h"
+
+#include <stdio.h>
+
+#define NNUE_VERSION 1
+// colour relative to the perspective, piece type and tile
+#define NNUE_INPUTS (2 * 6 * 64)
+#define NNUE_HIDDEN 256
+#define NNUE_LAYER1 32
+
+#define NNUE_WEIGHT_SHIFT 6
+#define NNUE_OUTPUT_SCALE 64
+
+// first layer sums, indexed by the colour whose point of view they are from
+struct NnueAccumulator
+{
+    int16_t values[2][NNUE_HIDDEN];
+} __attribute__((aligned(32)));
+
+// implementations of the layers after the accumulator. the fastest the
+// processor supports is picked when the program starts
+typedef enum
+{
+    NNUE_KERNEL_SCALAR = 0,
+    NNUE_KERNEL_SSE41,
+    NNUE_KERNEL_AVX2,
+} NnueKernel;
+
+// read a network file. returns false, keeping any network already loaded,
+// if it cannot be read or was made for another architecture
+bool loadNetwork(const char *path);
+// read a network from an open file, which must end with it
+bool readNetwork(FILE *file);
+bool isNetworkLoaded();
+
+// switch kernels, for comparing them. returns false if the processor does
+// not support the kernel
+bool selectNnueKernel(NnueKernel kernel);
+NnueKernel getNnueKernel();
+const char *getNnueKernelName(NnueKernel kernel);
+
+// recompute an accumulator from every piece on the board
+void refreshAccumulator(NnueAccumulator *acc, const Board *b);
+
+// replace the piece on a tile in the sums. called by setPiece
+void updateAccumulator(
+    NnueAccumulator *acc, Position tile, Piece old, Piece piece);
+
+// score the board's accumulator in centipawns for the side to move
+int evaluateNetwork(const Board *b);
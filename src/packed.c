@@ -0,0 +1,167 @@
+#include "packed.h"
+#include "zobrist.h"
+
+#include <assert.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool packPosition(const Board *b, PackedPosition *packed)
+{
+    Bitboard occupied = getOccupied(b);
+    if ((size_t)bitboardCount(occupied) > 2 * sizeof(packed->pieces))
+        return false;
+
+    packed->occupancy = occupied;
+    memset(packed->pieces, 0, sizeof(packed->pieces));
+    for (size_t i = 0; occupied; i++)
+    {
+        Piece p        = b->tiles[bitboardPopFirst(&occupied)];
+        uint8_t nibble = (p & 0x7f) | (getColour(p) == COLOUR_WHITE) << 3;
+        packed->pieces[i / 2] |= nibble << (i % 2 * 4);
+    }
+
+    packed->turn          = b->turn;
+    packed->castling      = b->castling;
+    packed->en_passant    = b->en_passant;
+    packed->halfmoveClock =
+        b->halfmoveClock < UINT8_MAX ? b->halfmoveClock : UINT8_MAX;
+    packed->moveCount = b->moveCount < UINT16_MAX ? b->moveCount : UINT16_MAX;
+    packed->result    = 0;
+    packed->reserved  = 0;
+    return true;
+}
+
+static bool readPacked(const PackedPosition *packed, Board *b)
+{
+    if (bitboardCount(packed->occupancy) > 32 || packed->turn > 1 ||
+        packed->castling > 15 || packed->en_passant < -1 ||
+        packed->en_passant > 7)
+        return false;
+
+    Bitboard occupied = packed->occupancy;
+    for (size_t i = 0; occupied; i++)
+    {
+        uint8_t nibble = packed->pieces[i / 2] >> (i % 2 * 4) & 0xf;
+        Piece p        = nibble & 7;
+        if (p == PIECE_BLANK || p >= PIECE_PIECE_MAX)
+            return false;
+        if (nibble & 8)
+            setColour(&p, COLOUR_WHITE);
+        setPiece(b, bitboardPopFirst(&occupied), p);
+    }
+    if (bitboardCount(getPieces(b, PIECE_KING, COLOUR_WHITE)) != 1 ||
+        bitboardCount(getPieces(b, PIECE_KING, COLOUR_BLACK)) != 1)
+        return false;
+
+    b->turn          = packed->turn;
+    b->castling      = packed->castling;
+    b->en_passant    = packed->en_passant;
+    b->halfmoveClock = packed->halfmoveClock;
+    b->moveCount     = packed->moveCount;
+    return true;
+}
+
+bool unpackPosition(const PackedPosition *packed, Board *b)
+{
+    *b = createBoard();
+    if (!readPacked(packed, b))
+    {
+        *b = createBoard();
+        return false;
+    }
+
+    // setPiece has hashed the pieces, the rest is hashed as parseFEN does
+    b->hash ^= zobristCastling[0] ^ zobristCastling[b->castling];
+    if (b->en_passant >= 0)
+        b->hash ^= zobristEnPassant[b->en_passant];
+    if (b->turn == COLOUR_BLACK)
+        b->hash ^= zobristTurn;
+    assert(b->hash == generateChecksum(b));
+    return true;
+}
+
+bool packPositions(const Board *boards, PackedPosition *packed, size_t count)
+{
+    bool ok = true;
+    for (size_t i = 0; i < count; i++)
+        ok &= packPosition(&boards[i], &packed[i]);
+    return ok;
+}
+
+bool unpackPositions(
+    const PackedPosition *packed, Board *boards, size_t count)
+{
+    bool ok = true;
+    for (size_t i = 0; i < count; i++)
+        ok &= unpackPosition(&packed[i], &boards[i]);
+    return ok;
+}
+
+bool writePackedHeader(FILE *file, uint64_t count)
+{
+    PackedHeader header = {
+        .magic      = PACKED_MAGIC,
+        .version    = PACKED_VERSION,
+        .recordSize = sizeof(PackedPosition),
+        .count      = count,
+    };
+    return fwrite(&header, sizeof(header), 1, file) == 1;
+}
+
+bool savePackedFile(
+    const char *path, const PackedPosition *positions, size_t count)
+{
+    FILE *file = fopen(path, "wb");
+    if (file == NULL)
+        return false;
+
+    bool ok = writePackedHeader(file, count) &&
+              fwrite(positions, sizeof(PackedPosition), count, file) == count;
+    return fclose(file) == 0 && ok;
+}
+
+bool openPackedFile(const char *path, PackedFile *file)
+{
+    memset(file, 0, sizeof(PackedFile));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat status;
+    void *map = MAP_FAILED;
+    if (fstat(fd, &status) == 0 &&
+        (size_t)status.st_size >= sizeof(PackedHeader))
+        map = mmap(NULL, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // the mapping stays valid without the descriptor
+    close(fd);
+    if (map == MAP_FAILED)
+        return false;
+
+    file->map       = map;
+    file->mapLength = status.st_size;
+
+    const PackedHeader *header = map;
+    size_t records =
+        (file->mapLength - sizeof(PackedHeader)) / sizeof(PackedPosition);
+    if (header->magic != PACKED_MAGIC || header->version != PACKED_VERSION ||
+        header->recordSize != sizeof(PackedPosition) ||
+        header->count > records)
+    {
+        closePackedFile(file);
+        return false;
+    }
+
+    file->positions = (const PackedPosition *)(header + 1);
+    file->count     = header->count;
+    return true;
+}
+
+void closePackedFile(PackedFile *file)
+{
+    if (file->map)
+        munmap(file->map, file->mapLength);
+    memset(file, 0, sizeof(PackedFile));
+}
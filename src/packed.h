@@ -0,0 +1,88 @@
+#pragma once
+
+// positions packed into 32 bytes, and files of them
+//
+// a record holds the occupied tiles as a bitboard, then a 4-bit piece for
+// each occupied tile in tile order, two to a byte, which is enough for 32
+// pieces. the side to move, castling rights, en passant file and clocks
+// follow. a file is a header and then the records, with nothing between,
+// so it can be mapped and any record read by its index
+
+#include "board.h"
+
+#include <stdio.h>
+
+// "CHPK", read as a little endian number. a file written on a machine with
+// the other byte order does not match
+#define PACKED_MAGIC 0x4b504843
+#define PACKED_VERSION 1
+
+typedef struct
+{
+    Bitboard occupancy;
+    // the piece type, with 8 added for white, of each occupied tile from
+    // the lowest. even pieces in the low half of a byte
+    uint8_t pieces[16];
+
+    uint8_t turn;
+    uint8_t castling;
+    int8_t en_passant;
+    // clamped to what fits
+    uint8_t halfmoveClock;
+    uint16_t moveCount;
+
+    // free for the dataset, such as the PgnResult of the game the position
+    // is from. cleared by packPosition and not read back
+    uint8_t result;
+    uint8_t reserved;
+} PackedPosition;
+
+_Static_assert(sizeof(PackedPosition) == 32, "packed positions are 32 bytes");
+
+// the start of a file, padded so the records after it stay aligned
+typedef struct
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;
+    uint64_t count;
+    uint8_t reserved[16];
+} PackedHeader;
+
+_Static_assert(sizeof(PackedHeader) == 32, "packed headers are 32 bytes");
+
+// a file mapped into memory. the positions are read in place
+typedef struct
+{
+    const PackedPosition *positions;
+    size_t count;
+
+    void *map;
+    size_t mapLength;
+} PackedFile;
+
+// returns false if the position has more than 32 pieces, which do not fit.
+// nothing is written then
+bool packPosition(const Board *b, PackedPosition *packed);
+// returns false if the record is not a position, such as one with a piece
+// that does not exist or without one king of each colour. the board is
+// left empty then
+bool unpackPosition(const PackedPosition *packed, Board *b);
+
+// returns false if any position did not fit. the rest are packed
+bool packPositions(const Board *boards, PackedPosition *packed, size_t count);
+// returns false if any record was not a position. the rest are unpacked
+bool unpackPositions(
+    const PackedPosition *packed, Board *boards, size_t count);
+
+// write a header for count records. a file written as a stream can have
+// its header written again once the count is known
+bool writePackedHeader(FILE *file, uint64_t count);
+// write a whole file. returns false if writing fails
+bool savePackedFile(
+    const char *path, const PackedPosition *positions, size_t count);
+
+// map a file. returns false if it can not be read, is not a file of
+// positions or is shorter than its header says
+bool openPackedFile(const char *path, PackedFile *file);
+void closePackedFile(PackedFile *file);
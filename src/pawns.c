@@ -0,0 +1,102 @@
+#include "pawns.h"
+
+#include <string.h>
+
+// tiles on the neighbouring files
+static Bitboard adjacentFiles[8];
+// tiles an enemy pawn would have to be on to stop a pawn from promoting,
+// indexed by colour and tile
+static Bitboard passedMasks[2][64];
+
+static const TaperedScore doubledPenalty  = {-10, -20};
+static const TaperedScore isolatedPenalty = {-10, -15};
+// indexed by the rows left to promotion
+static const TaperedScore passedBonus[8] = {
+    {0, 0}, {60, 130}, {40, 90}, {25, 60}, {15, 35}, {10, 20}, {5, 10}, {0, 0},
+};
+
+__attribute__((constructor)) static void initPawnMasks()
+{
+    for (int file = 0; file < 8; file++)
+    {
+        adjacentFiles[file] = 0;
+        if (file > 0)
+            adjacentFiles[file] |= BITBOARD_FILE_A << (file - 1);
+        if (file < 7)
+            adjacentFiles[file] |= BITBOARD_FILE_A << (file + 1);
+    }
+
+    for (int tile = 0; tile < 64; tile++)
+    {
+        int row = tile / 8, file = tile % 8;
+        Bitboard files = adjacentFiles[file] | BITBOARD_FILE_A << file;
+
+        // white pawns move towards row 0
+        passedMasks[COLOUR_WHITE][tile] = 0;
+        passedMasks[COLOUR_BLACK][tile] = 0;
+        for (int r = 0; r < 8; r++)
+        {
+            Bitboard rowMask = (Bitboard)0xff << (r * 8);
+            if (r < row)
+                passedMasks[COLOUR_WHITE][tile] |= files & rowMask;
+            if (r > row)
+                passedMasks[COLOUR_BLACK][tile] |= files & rowMask;
+        }
+    }
+}
+
+static void addScore(TaperedScore *total, TaperedScore s, int sign)
+{
+    total->middlegame += sign * s.middlegame;
+    total->endgame += sign * s.endgame;
+}
+
+TaperedScore evaluatePawns(const Board *b)
+{
+    TaperedScore total = {0, 0};
+    for (Colour c = COLOUR_BLACK; c <= COLOUR_WHITE; c++)
+    {
+        int sign       = c == COLOUR_WHITE ? 1 : -1;
+        Bitboard own   = getPieces(b, PIECE_PAWN, c);
+        Bitboard enemy = getPieces(b, PIECE_PAWN, otherColour(c));
+
+        for (int file = 0; file < 8; file++)
+        {
+            int count = bitboardCount(own & BITBOARD_FILE_A << file);
+            if (count > 1)
+                addScore(&total, doubledPenalty, sign * (count - 1));
+            if (count > 0 && (own & adjacentFiles[file]) == 0)
+                addScore(&total, isolatedPenalty, sign * count);
+        }
+
+        for (Bitboard pawns = own; pawns;)
+        {
+            Position tile = bitboardPopFirst(&pawns);
+            if (passedMasks[c][tile] & enemy)
+                continue;
+            int toGo = c == COLOUR_WHITE ? tile / 8 : 7 - tile / 8;
+            addScore(&total, passedBonus[toGo], sign);
+        }
+    }
+    return total;
+}
+
+void clearPawnCache(PawnCache *cache)
+{
+    memset(cache, 0, sizeof(PawnCache));
+}
+
+TaperedScore probePawns(PawnCache *cache, const Board *b)
+{
+    PawnEntry *entry = &cache->entries[b->pawnHash % PAWN_CACHE_ENTRIES];
+    cache->probes++;
+    if (entry->key == b->pawnHash)
+    {
+        cache->hits++;
+        return entry->score;
+    }
+
+    entry->key   = b->pawnHash;
+    entry->score = evaluatePawns(b);
+    return entry->score;
+}
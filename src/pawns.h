@@ -0,0 +1,33 @@
+#pragma once
+
+// pawn structure evaluation. it only depends on where the pawns are, so the
+// result is cached by the board's pawn hash and reused until a pawn moves
+
+#include "board.h"
+#include "position.h"
+
+#define PAWN_CACHE_ENTRIES 4096
+
+typedef struct
+{
+    uint64_t key; // pawn hash of the position
+    TaperedScore score;
+} PawnEntry;
+
+// each search thread has its own, so it needs no locking
+struct PawnCache
+{
+    PawnEntry entries[PAWN_CACHE_ENTRIES];
+    uint64_t probes;
+    uint64_t hits;
+};
+
+// forget every entry and reset the counters
+void clearPawnCache(PawnCache *cache);
+
+// doubled, isolated and passed pawns from white's point of view, computed
+// from scratch
+TaperedScore evaluatePawns(const Board *b);
+
+// evaluatePawns, looked up in the cache first
+TaperedScore probePawns(PawnCache *cache, const Board *b);
@@ -0,0 +1,336 @@
+#include "perft.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <time.h>
+
+uint64_t perft(Board *b, unsigned depth)
+{
+    if (depth == 0)
+        return 1;
+
+    MoveList moves;
+    generateMoves(b, &moves);
+
+    // the moves are legal, so the last ply can be counted without playing
+    if (depth == 1)
+        return moves.count;
+
+    uint64_t nodes = 0;
+    for (size_t i = 0; i < moves.count; i++)
+    {
+        MoveUndo undo;
+        makeMove(b, moves.moves[i], &undo);
+        nodes += perft(b, depth - 1);
+        unmakeMove(b, moves.moves[i], &undo);
+    }
+    return nodes;
+}
+
+bool createPerftCache(PerftCache *cache, size_t megabytes)
+{
+    // round down to a power of two so the index is a mask
+    size_t count = 1;
+    while (count * 2 * sizeof(PerftCacheEntry) <= megabytes << 20)
+        count *= 2;
+
+    cache->entries = calloc(count, sizeof(PerftCacheEntry));
+    cache->mask    = count - 1;
+    return cache->entries != NULL;
+}
+
+void destroyPerftCache(PerftCache *cache)
+{
+    free(cache->entries);
+    cache->entries = NULL;
+}
+
+// the same position at different depths has different counts, so the depth
+// is mixed into the slot as well as being checked on lookup
+static PerftCacheEntry *
+getCacheEntry(PerftCache *cache, uint64_t hash, unsigned depth)
+{
+    return &cache->entries
+                [(hash ^ (depth * 0x9e3779b97f4a7c15)) & cache->mask];
+}
+
+uint64_t perftHashed(
+    Board *b, unsigned depth, PerftCache *cache, PerftCacheStats *stats)
+{
+    // counting the last ply is cheaper than a cache lookup
+    if (depth <= 1)
+        return perft(b, depth);
+
+    // relaxed atomics compile to plain loads and stores, the xor check is
+    // what keeps the entries consistent
+    PerftCacheEntry *entry = getCacheEntry(cache, b->hash, depth);
+    uint64_t data  = atomic_load_explicit(&entry->data, memory_order_relaxed);
+    uint64_t check = atomic_load_explicit(&entry->check, memory_order_relaxed);
+    if (stats)
+        stats->probes++;
+    if ((check ^ data) == b->hash && (data & 0xff) == depth)
+    {
+        if (stats)
+            stats->hits++;
+        return data >> 8;
+    }
+
+    MoveList moves;
+    generateMoves(b, &moves);
+
+    uint64_t nodes = 0;
+    for (size_t i = 0; i < moves.count; i++)
+    {
+        MoveUndo undo;
+        makeMove(b, moves.moves[i], &undo);
+        nodes += perftHashed(b, depth - 1, cache, stats);
+        unmakeMove(b, moves.moves[i], &undo);
+    }
+
+    data = (nodes << 8) | depth;
+    atomic_store_explicit(&entry->data, data, memory_order_relaxed);
+    atomic_store_explicit(&entry->check, data ^ b->hash, memory_order_relaxed);
+    return nodes;
+}
+
+uint64_t
+perftDivide(Board *b, unsigned depth, MoveList *moves, uint64_t *counts)
+{
+    assert(depth > 0);
+    generateMoves(b, moves);
+
+    uint64_t nodes = 0;
+    for (size_t i = 0; i < moves->count; i++)
+    {
+        MoveUndo undo;
+        makeMove(b, moves->moves[i], &undo);
+        counts[i] = perft(b, depth - 1);
+        unmakeMove(b, moves->moves[i], &undo);
+        nodes += counts[i];
+    }
+    return nodes;
+}
+
+// a subtree to count, reached by playing up to two moves from the root
+typedef struct
+{
+    PackedMove moves[2];
+    unsigned plies;
+    size_t root; // index of the first move in the root move list
+    uint64_t nodes;
+} PerftTask;
+
+// a thread's share of the tasks. the owner takes from the end and thieves
+// take from the beginning. both ends live in one word so a single compare
+// and swap claims a task without locking
+typedef struct
+{
+    size_t *tasks;
+    _Atomic uint64_t range; // begin in the high 32 bits, end in the low 32
+} PerftQueue;
+
+typedef struct
+{
+    Board board;
+    PerftTask *tasks;
+    PerftQueue *queues;
+    PerftCache *cache;
+    unsigned threads;
+    unsigned index;
+    unsigned depth;
+    PerftThreadStats stats;
+} PerftWorker;
+
+static double seconds()
+{
+    struct timespec t;
+    timespec_get(&t, TIME_UTC);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static bool popTask(PerftQueue *q, bool steal, size_t *task)
+{
+    uint64_t range = atomic_load(&q->range);
+    for (;;)
+    {
+        uint32_t begin = range >> 32;
+        uint32_t end   = (uint32_t)range;
+        if (begin >= end)
+            return false;
+
+        uint64_t claimed = steal ? range + ((uint64_t)1 << 32) : range - 1;
+        if (atomic_compare_exchange_weak(&q->range, &range, claimed))
+        {
+            *task = q->tasks[steal ? begin : end - 1];
+            return true;
+        }
+    }
+}
+
+static void *runPerftWorker(void *arg)
+{
+    PerftWorker *w = arg;
+    double start   = seconds();
+
+    for (;;)
+    {
+        size_t t;
+        bool found = popTask(&w->queues[w->index], false, &t);
+        for (unsigned i = 1; i < w->threads && !found; i++)
+        {
+            found = popTask(&w->queues[(w->index + i) % w->threads], true, &t);
+            w->stats.stolen += found;
+        }
+        if (!found)
+            break;
+
+        PerftTask *task = &w->tasks[t];
+        MoveUndo undo[2];
+        for (unsigned ply = 0; ply < task->plies; ply++)
+            makeMove(&w->board, task->moves[ply], &undo[ply]);
+        unsigned depth = w->depth - task->plies;
+        if (w->cache)
+        {
+            task->nodes =
+                perftHashed(&w->board, depth, w->cache, &w->stats.cache);
+        }
+        else
+            task->nodes = perft(&w->board, depth);
+        for (unsigned ply = task->plies; ply-- > 0;)
+            unmakeMove(&w->board, task->moves[ply], &undo[ply]);
+
+        w->stats.nodes += task->nodes;
+        w->stats.tasks++;
+    }
+
+    w->stats.busy = seconds() - start;
+    return NULL;
+}
+
+bool perftParallel(
+    Board *b,
+    unsigned depth,
+    unsigned threads,
+    unsigned splitPly,
+    PerftCache *cache,
+    MoveList *moves,
+    uint64_t *counts,
+    PerftThreadStats *stats,
+    uint64_t *nodes)
+{
+    assert(depth > 0);
+    if (threads < 1)
+        threads = 1;
+    if (splitPly < 1)
+        splitPly = 1;
+    if (splitPly > 2)
+        splitPly = 2;
+    if (splitPly > depth)
+        splitPly = depth;
+
+    generateMoves(b, moves);
+
+    // list every subtree to count. there is one more than needed, so a
+    // position without moves still gets an allocation
+    size_t taskCount     = 0;
+    size_t perMove       = splitPly == 1 ? 1 : MAX_MOVES;
+    size_t maxTasks      = moves->count * perMove + 1;
+    PerftTask *tasks     = malloc(maxTasks * sizeof(PerftTask));
+    size_t *order        = malloc(maxTasks * sizeof(size_t));
+    PerftQueue *queues   = malloc(threads * sizeof(PerftQueue));
+    PerftWorker *workers = malloc(threads * sizeof(PerftWorker));
+    pthread_t *handles   = malloc(threads * sizeof(pthread_t));
+    bool *started        = malloc(threads * sizeof(bool));
+    if (!tasks || !order || !queues || !workers || !handles || !started)
+    {
+        free(started);
+        free(handles);
+        free(workers);
+        free(queues);
+        free(order);
+        free(tasks);
+        return false;
+    }
+
+    for (size_t i = 0; i < moves->count; i++)
+    {
+        counts[i] = 0;
+        if (splitPly == 1)
+        {
+            tasks[taskCount++] = (PerftTask){
+                .moves = {moves->moves[i]}, .plies = 1, .root = i};
+            continue;
+        }
+
+        MoveUndo undo;
+        MoveList replies;
+        makeMove(b, moves->moves[i], &undo);
+        generateMoves(b, &replies);
+        unmakeMove(b, moves->moves[i], &undo);
+        for (size_t j = 0; j < replies.count; j++)
+        {
+            tasks[taskCount++] = (PerftTask){
+                .moves = {moves->moves[i], replies.moves[j]},
+                .plies = 2,
+                .root  = i};
+        }
+    }
+
+    // deal the tasks out round robin, so every queue gets a mix of the
+    // large and small subtrees
+    size_t next = 0;
+    for (unsigned t = 0; t < threads; t++)
+    {
+        queues[t].tasks = &order[next];
+        uint32_t size   = 0;
+        for (size_t i = t; i < taskCount; i += threads)
+        {
+            order[next++] = i;
+            size++;
+        }
+        atomic_init(&queues[t].range, size);
+
+        workers[t] = (PerftWorker){
+            .board   = *b,
+            .tasks   = tasks,
+            .queues  = queues,
+            .cache   = cache,
+            .threads = threads,
+            .index   = t,
+            .depth   = depth,
+        };
+    }
+
+    // the calling thread works as thread 0. every thread steals from every
+    // queue, so the tasks of a thread that fails to start are still counted
+    for (unsigned t = 1; t < threads; t++)
+    {
+        started[t] = pthread_create(
+                         &handles[t], NULL, runPerftWorker, &workers[t]) == 0;
+    }
+    runPerftWorker(&workers[0]);
+    for (unsigned t = 1; t < threads; t++)
+    {
+        if (started[t])
+            pthread_join(handles[t], NULL);
+    }
+
+    *nodes = 0;
+    for (size_t i = 0; i < taskCount; i++)
+    {
+        counts[tasks[i].root] += tasks[i].nodes;
+        *nodes += tasks[i].nodes;
+    }
+    for (unsigned t = 0; stats && t < threads; t++)
+        stats[t] = workers[t].stats;
+
+    free(started);
+    free(handles);
+    free(workers);
+    free(queues);
+    free(order);
+    free(tasks);
+    return true;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+// count the leaves of the legal move tree. the counts for well known
+// positions are published, so they check the move generator, and the time
+// taken measures its speed
+
+#include "board.h"
+#include "moves.h"
+
+// count the positions reached after exactly depth moves
+uint64_t perft(Board *b, unsigned depth);
+
+// count the positions below each legal move. counts[i] is filled in for
+// moves->moves[i]. returns the total
+uint64_t
+perftDivide(Board *b, unsigned depth, MoveList *moves, uint64_t *counts);
+
+// one cached count. the check word is the key xored with the data, so an
+// entry torn by two threads writing at once fails validation instead of
+// returning a wrong count
+typedef struct
+{
+    _Atomic uint64_t check;
+    _Atomic uint64_t data; // node count in the high 56 bits, depth in the low 8
+} PerftCacheEntry;
+
+// counts of subtrees already seen, keyed by position hash and depth. it is
+// shared between threads without locking
+typedef struct
+{
+    PerftCacheEntry *entries;
+    size_t mask; // entry count - 1, the count is a power of two
+} PerftCache;
+
+typedef struct
+{
+    uint64_t probes;
+    uint64_t hits;
+} PerftCacheStats;
+
+// allocate a cache using at most megabytes of memory. returns false if the
+// memory could not be allocated
+bool createPerftCache(PerftCache *cache, size_t megabytes);
+void destroyPerftCache(PerftCache *cache);
+
+// perft that looks subtrees up in the cache before counting them, and
+// stores the ones it counts. stats may be NULL
+uint64_t perftHashed(
+    Board *b, unsigned depth, PerftCache *cache, PerftCacheStats *stats);
+
+// what one thread did during perftParallel
+typedef struct
+{
+    uint64_t nodes;        // leaves counted
+    size_t tasks;          // subtrees counted
+    size_t stolen;         // subtrees taken from another thread's queue
+    double busy;           // seconds spent working
+    PerftCacheStats cache; // only filled in when a cache is used
+} PerftThreadStats;
+
+// perftDivide spread over several threads. the subtrees below the first
+// splitPly moves (1 or 2) become tasks, dealt out to a queue per thread.
+// a thread that empties its queue steals from the others. each thread works
+// on its own copy of the board. if cache is not NULL the threads share it.
+// stats may be NULL, otherwise it needs an entry for each thread. returns
+// false if there is not enough memory, otherwise the count is in nodes
+bool perftParallel(
+    Board *b,
+    unsigned depth,
+    unsigned threads,
+    unsigned splitPly,
+    PerftCache *cache,
+    MoveList *moves,
+    uint64_t *counts,
+    PerftThreadStats *stats,
+    uint64_t *nodes);
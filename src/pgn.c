@@ -0,0 +1,420 @@
+#include "pgn.h"
+#include "fen.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#define START_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+
+// longest movetext line written
+#define PGN_LINE_LENGTH 79
+
+// longest token read from movetext, anything after is dropped
+#define PGN_MAX_TOKEN 32
+
+static const char *resultNames[] = {"*", "1-0", "0-1", "1/2-1/2"};
+
+// the standard start, read once for every game. the zobrist keys it needs
+// are only ready once the constructors have run, so it is read on first use
+static Board startBoard;
+static pthread_once_t startOnce = PTHREAD_ONCE_INIT;
+
+static void loadStartBoard() { loadPosition(&startBoard, START_FEN); }
+
+bool openPgn(PgnReader *reader, const char *path)
+{
+    reader->file        = fopen(path, "rb");
+    reader->data        = reader->buffer;
+    reader->length      = 0;
+    reader->next        = 0;
+    reader->line        = 1;
+    reader->atLineStart = true;
+    reader->bytesRead   = 0;
+    return reader->file != NULL;
+}
+
+void openPgnMemory(PgnReader *reader, const char *data, size_t length)
+{
+    reader->file        = NULL;
+    reader->data        = data;
+    reader->length      = length;
+    reader->next        = 0;
+    reader->line        = 1;
+    reader->atLineStart = true;
+    reader->bytesRead   = length;
+}
+
+void closePgn(PgnReader *reader)
+{
+    if (reader->file)
+        fclose(reader->file);
+    reader->file = NULL;
+}
+
+static int peekChar(PgnReader *r)
+{
+    if (r->next == r->length)
+    {
+        if (r->file == NULL)
+            return EOF;
+        r->length = fread(r->buffer, 1, PGN_BUFFER_SIZE, r->file);
+        r->next   = 0;
+        r->bytesRead += r->length;
+        if (r->length == 0)
+            return EOF;
+    }
+    return (unsigned char)r->data[r->next];
+}
+
+static int readChar(PgnReader *r)
+{
+    int c = peekChar(r);
+    if (c != EOF)
+    {
+        r->next++;
+        r->line += c == '\n';
+        r->atLineStart = c == '\n';
+    }
+    return c;
+}
+
+static bool isSpace(int c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// skip up to and including a character
+static void skipPast(PgnReader *r, int end)
+{
+    int c;
+    while ((c = readChar(r)) != EOF && c != end)
+        ;
+}
+
+// variations nest, and may hold comments with brackets in them
+static void skipVariation(PgnReader *r)
+{
+    unsigned depth = 0;
+    int c;
+    while ((c = readChar(r)) != EOF)
+    {
+        if (c == '(')
+            depth++;
+        else if (c == ')' && --depth == 0)
+            return;
+        else if (c == '{')
+            skipPast(r, '}');
+        else if (c == ';')
+            skipPast(r, '\n');
+    }
+}
+
+// copy as much of a string as fits
+static void copyString(char *to, const char *from, size_t size)
+{
+    size_t length = 0;
+    for (; length < size - 1 && from[length]; length++)
+        to[length] = from[length];
+    to[length] = '\0';
+}
+
+// [Name "value"], with \" and \\ escaped in the value. returns the tag
+// set, NULL if it had no name or there was no room
+static const PgnTag *readTag(PgnReader *r, PgnGame *game)
+{
+    char name[PGN_MAX_NAME];
+    char value[PGN_MAX_VALUE];
+    size_t nameLength = 0, valueLength = 0;
+
+    readChar(r);
+    int c;
+    while ((c = peekChar(r)) != EOF && isSpace(c))
+        readChar(r);
+    while ((c = peekChar(r)) != EOF && !isSpace(c) && c != '"' && c != ']')
+    {
+        readChar(r);
+        if (nameLength < PGN_MAX_NAME - 1)
+            name[nameLength++] = c;
+    }
+    name[nameLength] = '\0';
+
+    while ((c = readChar(r)) != EOF && c != '"' && c != ']')
+        ;
+    if (c == '"')
+    {
+        while ((c = readChar(r)) != EOF && c != '"')
+        {
+            if (c == '\\')
+                c = readChar(r);
+            if (c != EOF && valueLength < PGN_MAX_VALUE - 1)
+                value[valueLength++] = c;
+        }
+        skipPast(r, ']');
+    }
+    value[valueLength] = '\0';
+
+    if (nameLength == 0 || !setPgnTag(game, name, value))
+        return NULL;
+    for (size_t i = 0;; i++)
+    {
+        if (strcmp(game->tags[i].name, name) == 0)
+            return &game->tags[i];
+    }
+}
+
+// movetext tokens end at spaces and at the characters that start something
+// else
+static size_t readToken(PgnReader *r, char *token)
+{
+    size_t length = 0;
+    int c;
+    while ((c = peekChar(r)) != EOF && c && !isSpace(c) &&
+           !strchr("{}()[];$", c))
+    {
+        readChar(r);
+        if (length < PGN_MAX_TOKEN - 1)
+            token[length++] = c;
+    }
+    token[length] = '\0';
+    return length;
+}
+
+const char *getPgnResultName(PgnResult result)
+{
+    return resultNames[result];
+}
+
+void initPgnGame(PgnGame *game, const Board *start)
+{
+    game->tagCount  = 0;
+    game->start     = *start;
+    game->board     = *start;
+    game->moveCount = 0;
+    game->result    = PGN_RESULT_UNKNOWN;
+    game->errorLine = 0;
+}
+
+const char *getPgnTag(const PgnGame *game, const char *name)
+{
+    for (size_t i = 0; i < game->tagCount; i++)
+    {
+        if (strcmp(game->tags[i].name, name) == 0)
+            return game->tags[i].value;
+    }
+    return NULL;
+}
+
+bool setPgnTag(PgnGame *game, const char *name, const char *value)
+{
+    size_t i = 0;
+    while (i < game->tagCount && strcmp(game->tags[i].name, name))
+        i++;
+    if (i == PGN_MAX_TAGS)
+        return false;
+
+    if (i == game->tagCount)
+    {
+        copyString(game->tags[i].name, name, PGN_MAX_NAME);
+        game->tagCount++;
+    }
+    copyString(game->tags[i].value, value, PGN_MAX_VALUE);
+    return true;
+}
+
+bool addPgnMove(PgnGame *game, PackedMove m)
+{
+    if (game->moveCount == PGN_MAX_MOVES)
+        return false;
+
+    MoveUndo undo;
+    makeMove(&game->board, m, &undo);
+    game->moves[game->moveCount++] = m;
+    return true;
+}
+
+// the result at the end of the movetext, if a token is one
+static bool readResult(const char *token, PgnResult *result)
+{
+    for (PgnResult i = PGN_RESULT_UNKNOWN; i <= PGN_RESULT_DRAW; i++)
+    {
+        if (strcmp(token, resultNames[i]) == 0)
+        {
+            *result = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// a game ends at its result, at the next game's tags if it has no result,
+// or at the end of the file
+PgnStatus readPgnGame(PgnReader *r, PgnGame *game)
+{
+    pthread_once(&startOnce, loadStartBoard);
+    initPgnGame(game, &startBoard);
+
+    PgnStatus status = PGN_OK;
+    bool inMoves     = false;
+    for (;;)
+    {
+        int c = peekChar(r);
+        if (c == EOF)
+            return inMoves || game->tagCount ? status : PGN_END;
+
+        if (isSpace(c))
+        {
+            readChar(r);
+            continue;
+        }
+        if (c == '%' && r->atLineStart)
+        {
+            skipPast(r, '\n');
+            continue;
+        }
+
+        if (c == '[')
+        {
+            if (inMoves)
+                return status;
+            const PgnTag *tag = readTag(r, game);
+
+            // a game from another position names it before any move
+            if (tag && strcmp(tag->name, "FEN") == 0)
+            {
+                if (loadPosition(&game->start, tag->value) != FEN_OK)
+                {
+                    status          = PGN_BAD_FEN;
+                    game->errorLine = r->line;
+                }
+                game->board = game->start;
+            }
+            continue;
+        }
+        if (c == '{')
+        {
+            skipPast(r, '}');
+            continue;
+        }
+        if (c == ';')
+        {
+            skipPast(r, '\n');
+            continue;
+        }
+        if (c == '(')
+        {
+            skipVariation(r);
+            continue;
+        }
+
+        // glyphs are a number after the $, stray brackets are ignored
+        char token[PGN_MAX_TOKEN];
+        if (c == '$' || c == ')' || c == '}' || c == ']')
+        {
+            readChar(r);
+            if (c == '$')
+                readToken(r, token);
+            continue;
+        }
+
+        // anything else that can not start a token is skipped
+        if (readToken(r, token) == 0)
+        {
+            readChar(r);
+            continue;
+        }
+        inMoves = true;
+        if (readResult(token, &game->result))
+            return status;
+        // the rest of a game is not read once a move fails
+        if (status != PGN_OK)
+            continue;
+
+        // move numbers may run into the move, as in 1.e4 or 12...Nf6
+        const char *san = token;
+        while (*san >= '0' && *san <= '9')
+            san++;
+        if (*san == '.')
+        {
+            while (*san == '.')
+                san++;
+        }
+        else
+            san = token;
+        if (*san == '\0')
+            continue;
+
+        PackedMove m = parseSan(&game->board, san);
+        if (m == MOVE_NONE || !addPgnMove(game, m))
+        {
+            status          = PGN_BAD_MOVE;
+            game->errorLine = r->line;
+        }
+    }
+}
+
+static bool writeTag(FILE *file, const PgnTag *tag)
+{
+    if (fprintf(file, "[%s \"", tag->name) < 0)
+        return false;
+    for (const char *c = tag->value; *c; c++)
+    {
+        if ((*c == '"' || *c == '\\') && fputc('\\', file) == EOF)
+            return false;
+        if (fputc(*c, file) == EOF)
+            return false;
+    }
+    return fputs("\"]\n", file) != EOF;
+}
+
+bool writePgnGame(FILE *file, const PgnGame *game)
+{
+    for (size_t i = 0; i < game->tagCount; i++)
+    {
+        if (!writeTag(file, &game->tags[i]))
+            return false;
+    }
+    if (game->tagCount && fputc('\n', file) == EOF)
+        return false;
+
+    // each move is written as it is played from the start, lines are
+    // broken before they grow too long
+    Board b       = game->start;
+    size_t column = 0;
+    for (size_t i = 0; i <= game->moveCount; i++)
+    {
+        // number, up to "1234... ", then the move
+        char text[16 + SAN_MAX_LENGTH];
+        size_t length = 0;
+        if (i == game->moveCount)
+            length = strlen(strcpy(text, resultNames[game->result]));
+        else
+        {
+            size_t number = b.moveCount / 2 + 1;
+            if (b.turn == COLOUR_WHITE)
+                length = sprintf(text, "%zu. ", number);
+            else if (i == 0)
+                length = sprintf(text, "%zu... ", number);
+            moveToSan(&b, game->moves[i], text + length);
+            length += strlen(text + length);
+
+            MoveUndo undo;
+            makeMove(&b, game->moves[i], &undo);
+        }
+
+        if (column && column + 1 + length > PGN_LINE_LENGTH)
+        {
+            if (fputc('\n', file) == EOF)
+                return false;
+            column = 0;
+        }
+        else if (column && fputc(' ', file) == EOF)
+            return false;
+        else if (column)
+            column++;
+
+        if (fputs(text, file) == EOF)
+            return false;
+        column += length;
+    }
+    return fputs("\n\n", file) != EOF;
+}
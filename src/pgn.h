@@ -0,0 +1,107 @@
+#pragma once
+
+// reading and writing games in portable game notation
+//
+// the reader streams a file through a fixed buffer, so files of any size
+// are read without holding them in memory, and a game is read into a
+// caller's PgnGame without allocating. moves are decoded from algebraic
+// notation against the legal moves and played on the game's board.
+// comments, variations, annotation glyphs and escaped lines are skipped
+
+#include "board.h"
+#include "moves.h"
+
+#include <stdio.h>
+
+#define PGN_BUFFER_SIZE (1 << 16)
+
+// longer games, tag names and values are cut short
+#define PGN_MAX_MOVES 1024
+#define PGN_MAX_TAGS 32
+#define PGN_MAX_NAME 32
+#define PGN_MAX_VALUE 256
+
+typedef enum
+{
+    PGN_OK = 0,
+    // a game was read but one of its moves was illegal, ambiguous or past
+    // PGN_MAX_MOVES. the moves before it were kept
+    PGN_BAD_MOVE,
+    // a game was read but its FEN tag was invalid. it has no moves
+    PGN_BAD_FEN,
+    // there are no more games
+    PGN_END,
+} PgnStatus;
+
+typedef enum
+{
+    PGN_RESULT_UNKNOWN = 0,
+    PGN_RESULT_WHITE,
+    PGN_RESULT_BLACK,
+    PGN_RESULT_DRAW,
+} PgnResult;
+
+typedef struct
+{
+    char name[PGN_MAX_NAME];
+    char value[PGN_MAX_VALUE];
+} PgnTag;
+
+typedef struct
+{
+    PgnTag tags[PGN_MAX_TAGS];
+    size_t tagCount;
+
+    // the standard start, or the FEN tag's position
+    Board start;
+    PackedMove moves[PGN_MAX_MOVES];
+    size_t moveCount;
+    // the position after the last move
+    Board board;
+
+    PgnResult result;
+    // line the error was found on, for anything but PGN_OK
+    size_t errorLine;
+} PgnGame;
+
+typedef struct
+{
+    FILE *file; // NULL when reading from memory
+    char buffer[PGN_BUFFER_SIZE];
+    // the bytes being read, in the buffer or the caller's memory
+    const char *data;
+    size_t length; // bytes in data
+    size_t next;   // next byte to read
+    size_t line;   // line of the next byte, counted from 1
+    // the next byte starts a line, where '%' escapes the rest of it
+    bool atLineStart;
+    // bytes read from the file so far, for reporting progress
+    uint64_t bytesRead;
+} PgnReader;
+
+// returns false if the file can not be opened
+bool openPgn(PgnReader *reader, const char *path);
+// read games from memory instead. it is not copied, so it must be kept
+// until the games have been read
+void openPgnMemory(PgnReader *reader, const char *data, size_t length);
+void closePgn(PgnReader *reader);
+
+// read the next game from a reader
+PgnStatus readPgnGame(PgnReader *reader, PgnGame *game);
+
+// the result as it is written in movetext, such as 1-0
+const char *getPgnResultName(PgnResult result);
+
+// start an empty game from a position, for building one to write
+void initPgnGame(PgnGame *game, const Board *start);
+// the value of a tag, NULL if the game does not have it
+const char *getPgnTag(const PgnGame *game, const char *name);
+// add a tag or replace its value. returns false if there are too many
+bool setPgnTag(PgnGame *game, const char *name, const char *value);
+// play a legal move at the end of the game. returns false if the game is
+// full
+bool addPgnMove(PgnGame *game, PackedMove m);
+
+// write a game, its tags in the order they were added and its moves in
+// algebraic notation. returns false if writing fails
+bool writePgnGame(FILE *file, const PgnGame *game);
@@ -0,0 +1,285 @@
+#include "position.h"
+#include "attacks.h"
+#include "nnue.h"
+#include "pawns.h"
+
+const int pieceValues[PIECE_PIECE_MAX] = {
+    [PIECE_BLANK]  = 0,
+    [PIECE_PAWN]   = 100,
+    [PIECE_KNIGHT] = 320,
+    [PIECE_BISHOP] = 330,
+    [PIECE_ROOK]   = 500,
+    [PIECE_QUEEN]  = 900,
+    [PIECE_KING]   = 0,
+};
+
+// what losing each piece type costs in an exchange. the king can only
+// capture last, as nothing may take it back
+static const int exchangeValues[PIECE_PIECE_MAX] = {
+    [PIECE_PAWN]   = 100,
+    [PIECE_KNIGHT] = 320,
+    [PIECE_BISHOP] = 330,
+    [PIECE_ROOK]   = 500,
+    [PIECE_QUEEN]  = 900,
+    [PIECE_KING]   = 20000,
+};
+
+int staticExchangeEval(Board *b, PackedMove m)
+{
+    const unsigned flags = getMoveFlags(m);
+    if (flags == MOVE_CASTLE_KING || flags == MOVE_CASTLE_QUEEN)
+        return 0;
+
+    const Position from = getMoveFrom(m), to = getMoveTo(m);
+    Bitboard occupied   = getOccupied(b) ^ bitboardSquare(from);
+    Piece victim        = b->tiles[to] & 0x7f;
+    if (flags == MOVE_EN_PASSANT)
+    {
+        victim = PIECE_PAWN;
+        occupied ^= bitboardSquare(to + (b->turn == COLOUR_WHITE ? 8 : -8));
+    }
+
+    // gains[d] is what the side making capture d wins if the exchange
+    // stops after it
+    int gains[32];
+    Piece attacker = b->tiles[from] & 0x7f;
+    gains[0]       = exchangeValues[victim];
+    if (isPromotion(m))
+    {
+        attacker = getPromotionPiece(m);
+        gains[0] += exchangeValues[attacker] - exchangeValues[PIECE_PAWN];
+    }
+
+    const Bitboard diagonal =
+        b->pieces[PIECE_BISHOP] | b->pieces[PIECE_QUEEN];
+    const Bitboard straight = b->pieces[PIECE_ROOK] | b->pieces[PIECE_QUEEN];
+    Bitboard attackers      = getAttackers(b, to, occupied) & occupied;
+    Colour side             = otherColour(b->turn);
+
+    int depth = 0;
+    while (depth < 31)
+    {
+        Bitboard ours = attackers & b->colours[side];
+        if (ours == BITBOARD_EMPTY)
+            break;
+
+        // the king may not capture into a defended tile
+        Piece type = PIECE_PAWN;
+        while (!(ours & b->pieces[type]))
+            type++;
+        if (type == PIECE_KING && (attackers & b->colours[otherColour(side)]))
+            break;
+
+        depth++;
+        gains[depth] = exchangeValues[attacker] - gains[depth - 1];
+        attacker     = type;
+
+        // taking the piece away may uncover a slider behind it
+        occupied ^= bitboardSquare(bitboardFirst(ours & b->pieces[type]));
+        if (type == PIECE_PAWN || type == PIECE_BISHOP || type == PIECE_QUEEN)
+            attackers |= bishopAttacks(to, occupied) & diagonal;
+        if (type == PIECE_ROOK || type == PIECE_QUEEN)
+            attackers |= rookAttacks(to, occupied) & straight;
+        attackers &= occupied;
+        side = otherColour(side);
+    }
+
+    // each side may stop capturing when carrying on would lose
+    for (; depth > 0; depth--)
+    {
+        if (gains[depth] > -gains[depth - 1])
+            gains[depth - 1] = -gains[depth];
+    }
+    return gains[0];
+}
+
+// pawns are worth more once there is room to promote them, the minor pieces
+// less without targets
+static const TaperedScore materialScores[PIECE_PIECE_MAX] = {
+    [PIECE_PAWN]   = {90, 120},
+    [PIECE_KNIGHT] = {325, 300},
+    [PIECE_BISHOP] = {335, 320},
+    [PIECE_ROOK]   = {480, 540},
+    [PIECE_QUEEN]  = {950, 980},
+};
+
+const int phaseWeights[PIECE_PIECE_MAX] = {
+    [PIECE_KNIGHT] = 1,
+    [PIECE_BISHOP] = 1,
+    [PIECE_ROOK]   = 2,
+    [PIECE_QUEEN]  = 4,
+};
+
+TaperedScore pieceSquareScores[2][PIECE_PIECE_MAX][64];
+
+// bonuses for white pieces, laid out like the board with the top row first.
+// black uses them mirrored top to bottom
+
+// clang-format off
+static const int8_t pawnMiddlegame[64] = {
+     0,   0,   0,   0,   0,   0,   0,   0,
+    50,  50,  50,  50,  50,  50,  50,  50,
+    10,  10,  20,  30,  30,  20,  10,  10,
+     5,   5,  10,  25,  25,  10,   5,   5,
+     0,   0,   0,  20,  20,   0,   0,   0,
+     5,  -5, -10,   0,   0, -10,  -5,   5,
+     5,  10,  10, -20, -20,  10,  10,   5,
+     0,   0,   0,   0,   0,   0,   0,   0,
+};
+
+static const int8_t pawnEndgame[64] = {
+     0,   0,   0,   0,   0,   0,   0,   0,
+    80,  80,  80,  80,  80,  80,  80,  80,
+    50,  50,  50,  50,  50,  50,  50,  50,
+    30,  30,  30,  30,  30,  30,  30,  30,
+    15,  15,  15,  15,  15,  15,  15,  15,
+     5,   5,   5,   5,   5,   5,   5,   5,
+     0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,
+};
+
+static const int8_t knightSquares[64] = {
+   -50, -40, -30, -30, -30, -30, -40, -50,
+   -40, -20,   0,   0,   0,   0, -20, -40,
+   -30,   0,  10,  15,  15,  10,   0, -30,
+   -30,   5,  15,  20,  20,  15,   5, -30,
+   -30,   0,  15,  20,  20,  15,   0, -30,
+   -30,   5,  10,  15,  15,  10,   5, -30,
+   -40, -20,   0,   5,   5,   0, -20, -40,
+   -50, -40, -30, -30, -30, -30, -40, -50,
+};
+
+static const int8_t bishopSquares[64] = {
+   -20, -10, -10, -10, -10, -10, -10, -20,
+   -10,   0,   0,   0,   0,   0,   0, -10,
+   -10,   0,   5,  10,  10,   5,   0, -10,
+   -10,   5,   5,  10,  10,   5,   5, -10,
+   -10,   0,  10,  10,  10,  10,   0, -10,
+   -10,  10,  10,  10,  10,  10,  10, -10,
+   -10,   5,   0,   0,   0,   0,   5, -10,
+   -20, -10, -10, -10, -10, -10, -10, -20,
+};
+
+static const int8_t rookSquares[64] = {
+     0,   0,   0,   0,   0,   0,   0,   0,
+     5,  10,  10,  10,  10,  10,  10,   5,
+    -5,   0,   0,   0,   0,   0,   0,  -5,
+    -5,   0,   0,   0,   0,   0,   0,  -5,
+    -5,   0,   0,   0,   0,   0,   0,  -5,
+    -5,   0,   0,   0,   0,   0,   0,  -5,
+    -5,   0,   0,   0,   0,   0,   0,  -5,
+     0,   0,   0,   5,   5,   0,   0,   0,
+};
+
+static const int8_t queenSquares[64] = {
+   -20, -10, -10,  -5,  -5, -10, -10, -20,
+   -10,   0,   0,   0,   0,   0,   0, -10,
+   -10,   0,   5,   5,   5,   5,   0, -10,
+    -5,   0,   5,   5,   5,   5,   0,  -5,
+     0,   0,   5,   5,   5,   5,   0,  -5,
+   -10,   5,   5,   5,   5,   5,   0, -10,
+   -10,   0,   5,   0,   0,   0,   0, -10,
+   -20, -10, -10,  -5,  -5, -10, -10, -20,
+};
+
+// the king hides behind its pawns while there is material to attack it
+// with, and joins in once there is not
+static const int8_t kingMiddlegame[64] = {
+   -30, -40, -40, -50, -50, -40, -40, -30,
+   -30, -40, -40, -50, -50, -40, -40, -30,
+   -30, -40, -40, -50, -50, -40, -40, -30,
+   -30, -40, -40, -50, -50, -40, -40, -30,
+   -20, -30, -30, -40, -40, -30, -30, -20,
+   -10, -20, -20, -20, -20, -20, -20, -10,
+    20,  20,   0,   0,   0,   0,  20,  20,
+    20,  30,  10,   0,   0,  10,  30,  20,
+};
+
+static const int8_t kingEndgame[64] = {
+   -50, -40, -30, -20, -20, -30, -40, -50,
+   -30, -20, -10,   0,   0, -10, -20, -30,
+   -30, -10,  20,  30,  30,  20, -10, -30,
+   -30, -10,  30,  40,  40,  30, -10, -30,
+   -30, -10,  30,  40,  40,  30, -10, -30,
+   -30, -10,  20,  30,  30,  20, -10, -30,
+   -30, -30,   0,   0,   0,   0, -30, -30,
+   -50, -30, -30, -30, -30, -30, -30, -50,
+};
+// clang-format on
+
+static const int8_t *const middlegameSquares[PIECE_PIECE_MAX] = {
+    [PIECE_PAWN]   = pawnMiddlegame,
+    [PIECE_KNIGHT] = knightSquares,
+    [PIECE_BISHOP] = bishopSquares,
+    [PIECE_ROOK]   = rookSquares,
+    [PIECE_QUEEN]  = queenSquares,
+    [PIECE_KING]   = kingMiddlegame,
+};
+
+static const int8_t *const endgameSquares[PIECE_PIECE_MAX] = {
+    [PIECE_PAWN]   = pawnEndgame,
+    [PIECE_KNIGHT] = knightSquares,
+    [PIECE_BISHOP] = bishopSquares,
+    [PIECE_ROOK]   = rookSquares,
+    [PIECE_QUEEN]  = queenSquares,
+    [PIECE_KING]   = kingEndgame,
+};
+
+__attribute__((constructor)) void initPieceSquareScores()
+{
+    for (size_t piece = PIECE_PAWN; piece < PIECE_PIECE_MAX; piece++)
+    {
+        for (size_t tile = 0; tile < 64; tile++)
+        {
+            TaperedScore white = {
+                materialScores[piece].middlegame +
+                    middlegameSquares[piece][tile],
+                materialScores[piece].endgame + endgameSquares[piece][tile],
+            };
+            pieceSquareScores[COLOUR_WHITE][piece][tile] = white;
+
+            // flipping the row mirrors the tile for black
+            pieceSquareScores[COLOUR_BLACK][piece][tile ^ 56] = (TaperedScore){
+                -white.middlegame,
+                -white.endgame,
+            };
+        }
+    }
+}
+
+int getPhase(const Board *b)
+{
+    int phase = 0;
+    for (Piece type = PIECE_KNIGHT; type < PIECE_KING; type++)
+        phase += phaseWeights[type] * bitboardCount(b->pieces[type]);
+
+    // promotions can take the phase past its starting value
+    return phase < PHASE_MAX ? phase : PHASE_MAX;
+}
+
+static Evaluator evaluator = EVALUATOR_CLASSICAL;
+
+bool setEvaluator(Evaluator e)
+{
+    if (e == EVALUATOR_NETWORK && !isNetworkLoaded())
+        return false;
+    evaluator = e;
+    return true;
+}
+
+Evaluator getEvaluator() { return evaluator; }
+
+int evaluate(Board *b, PawnCache *pawns)
+{
+    if (evaluator == EVALUATOR_NETWORK && b->accumulator)
+        return evaluateNetwork(b);
+
+    TaperedScore structure = pawns ? probePawns(pawns, b) : evaluatePawns(b);
+    int middlegame         = b->middlegameScore + structure.middlegame;
+    int endgame            = b->endgameScore + structure.endgame;
+
+    int phase = getPhase(b);
+    int score =
+        (middlegame * phase + endgame * (PHASE_MAX - phase)) / PHASE_MAX;
+    return b->turn == COLOUR_WHITE ? score : -score;
+}
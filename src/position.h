@@ -1,3 +1,64 @@
 #pragma once
 
-// evaluate a position, so the engine
\ No newline at end of file
+// evaluate a position, so the engine
+
+#include "board.h"
+#include "moves.h"
+
+// value of each piece type in centipawns
+extern const int pieceValues[PIECE_PIECE_MAX];
+
+// static exchange evaluation. the material in centipawns the side to move
+// gains by playing a move, after which both sides keep recapturing on its
+// tile with their least valuable piece for as long as that pays. pins and
+// checks are ignored
+int staticExchangeEval(Board *b, PackedMove m);
+
+// a score for the middlegame and one for the endgame. the evaluation blends
+// the two by how much material is left
+typedef struct
+{
+    int16_t middlegame;
+    int16_t endgame;
+} TaperedScore;
+
+// material plus piece square bonus for a piece on a tile, from white's point
+// of view, indexed by colour, piece type and tile. blank pieces score zero
+extern TaperedScore pieceSquareScores[2][PIECE_PIECE_MAX][64];
+
+// how much each piece type counts towards the game phase. with every piece
+// on the board the phase is PHASE_MAX and the middlegame score is used alone
+extern const int phaseWeights[PIECE_PIECE_MAX];
+#define PHASE_MAX 24
+
+// the game phase, from the piece counts setPiece keeps in the bitboards
+int getPhase(const Board *b);
+
+// build the piece square scores, run automatically before main
+void initPieceSquareScores();
+
+static inline TaperedScore pieceSquareScore(Piece p, Position tile)
+{
+    return pieceSquareScores[getColour(p)][p & 0x7f][tile];
+}
+
+// defined in pawns.h
+typedef struct PawnCache PawnCache;
+
+// what evaluate() scores positions with
+typedef enum
+{
+    EVALUATOR_CLASSICAL = 0, // material, piece squares and pawn structure
+    EVALUATOR_NETWORK,       // the network loaded by loadNetwork
+} Evaluator;
+
+// returns false, keeping the current evaluator, if the network is chosen
+// before one is loaded
+bool setEvaluator(Evaluator e);
+Evaluator getEvaluator();
+
+// score the position in centipawns, positive when the side to move is
+// better off. the classical evaluation blends the sums setPiece keeps in the
+// board with the pawn structure, which is looked up in the cache when there
+// is one. the network is only used on boards with an accumulator attached
+int evaluate(Board *b, PawnCache *pawns);
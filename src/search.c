@@ -0,0 +1,745 @@
+#include "search.h"
+#include "movepick.h"
+#include "nnue.h"
+#include "pawns.h"
+#include "position.h"
+#include "timeman.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// nodes searched between looks at the clock
+#define CHECK_INTERVAL 1024
+
+// selective search margins, in centipawns per ply of depth left
+#define FUTILITY_MARGIN 120
+#define REVERSE_FUTILITY_MARGIN 90
+// deepest nodes futility pruning applies to
+#define FUTILITY_DEPTH 3
+#define REVERSE_FUTILITY_DEPTH 6
+
+// first window searched around the previous score
+#define ASPIRATION_WINDOW 25
+#define ASPIRATION_DEPTH 5
+
+// plies a late move is reduced by, indexed by depth and the move's place in
+// the ordering. the later and deeper, the more it is reduced
+static int reductions[64][64];
+
+__attribute__((constructor)) static void initReductions()
+{
+    for (int depth = 1; depth < 64; depth++)
+    {
+        for (int i = 1; i < 64; i++)
+            reductions[depth][i] = 0.5 + log(depth) * log(i) / 2.25;
+    }
+}
+
+// state shared by the threads of one search
+typedef struct
+{
+    double start;
+    unsigned maxDepth;
+    // milliseconds from the start at which every thread stops, 0 for none
+    unsigned long deadline;
+    // set when playing on a clock
+    bool timed;
+    TimeBudget budget;
+    atomic_bool stop;
+    // nodes searched so far, added to by each thread every CHECK_INTERVAL
+    _Atomic uint64_t nodes;
+    SearchResult *result;
+} SearchShared;
+
+typedef struct
+{
+    Board board;
+    SearchLimits limits;
+    SearchShared *shared;
+    unsigned id; // 0 is the main thread
+    uint64_t nodes;
+    uint64_t flushedNodes; // part of nodes already in the shared count
+    bool stopped;
+
+    TranspositionTable *tt;
+    uint64_t ttProbes;
+    uint64_t ttHits;
+    uint64_t ttStores;
+    uint64_t ttOverwrites;
+
+    PawnCache pawns;
+    NnueAccumulator accumulator;
+
+    // move ordering. killers are quiet moves that caused a cutoff at the
+    // same ply
+    PackedMove killers[MAX_PLY][2];
+    HistoryTable history;
+    uint64_t cutoffs;
+    uint64_t firstMoveCutoffs;
+
+    // hashes of the positions on the current line, for finding repetitions
+    uint64_t hashes[MAX_PLY];
+    // whether the move into each ply was a null move, so two are not made
+    // in a row
+    bool nullMoves[MAX_PLY];
+
+    // triangular table of principal variations. pv[ply] holds the best line
+    // found from ply onwards, in pv[ply][ply] to pv[ply][pvLength[ply] - 1]
+    PackedMove pv[MAX_PLY][MAX_PLY];
+    size_t pvLength[MAX_PLY];
+
+    // the previous iteration's line is searched first while the search is
+    // still following it
+    PackedMove previousPv[MAX_PLY];
+    size_t previousPvLength;
+    bool followPv;
+
+    // last completed iteration, its line is previousPv
+    int score;
+    unsigned depth;
+} SearchThread;
+
+static double seconds()
+{
+    struct timespec t;
+    timespec_get(&t, TIME_UTC);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// whichever thread reaches a limit first stops all of them
+static bool shouldStop(SearchThread *t)
+{
+    if (t->stopped)
+        return true;
+
+    SearchShared *shared = t->shared;
+    if (t->nodes % CHECK_INTERVAL == 0)
+    {
+        atomic_fetch_add_explicit(
+            &shared->nodes, t->nodes - t->flushedNodes, memory_order_relaxed);
+        t->flushedNodes = t->nodes;
+        if (shared->deadline &&
+            (seconds() - shared->start) * 1000 >= shared->deadline)
+            atomic_store(&shared->stop, true);
+        if (t->limits.stop &&
+            atomic_load_explicit(t->limits.stop, memory_order_relaxed))
+            atomic_store(&shared->stop, true);
+    }
+    // exact for a single thread, the others' latest nodes are not counted
+    if (t->limits.nodes &&
+        atomic_load_explicit(&shared->nodes, memory_order_relaxed) + t->nodes -
+                t->flushedNodes >=
+            t->limits.nodes)
+        atomic_store(&shared->stop, true);
+
+    t->stopped = atomic_load_explicit(&shared->stop, memory_order_relaxed);
+    return t->stopped;
+}
+
+// fifty moves without progress, or a position repeated since the last
+// irreversible move. the line searched is looked through first, then the
+// game played before it
+static bool isDraw(SearchThread *t, int ply)
+{
+    const Board *b = &t->board;
+    if (b->halfmoveClock >= 100)
+        return true;
+
+    const uint64_t *history = t->limits.history;
+    const int historyLength = t->limits.historyLength;
+    for (int back = 2; back <= (int)b->halfmoveClock; back += 2)
+    {
+        int i = ply - back;
+        if (i < -historyLength)
+            break;
+        if ((i >= 0 ? t->hashes[i] : history[historyLength + i]) == b->hash)
+            return true;
+    }
+    return false;
+}
+
+// mate scores count plies from the root, but the table is shared between
+// positions at any ply. store them counted from the position instead
+static int scoreToTT(int score, int ply)
+{
+    if (score >= MATE_BOUND)
+        return score + ply;
+    if (score <= -MATE_BOUND)
+        return score - ply;
+    return score;
+}
+
+static int scoreFromTT(int score, int ply)
+{
+    if (score >= MATE_BOUND)
+        return score - ply;
+    if (score <= -MATE_BOUND)
+        return score + ply;
+    return score;
+}
+
+static void updatePv(SearchThread *t, int ply, PackedMove m)
+{
+    t->pv[ply][ply] = m;
+    for (size_t i = ply + 1; i < t->pvLength[ply + 1]; i++)
+        t->pv[ply][i] = t->pv[ply + 1][i];
+    t->pvLength[ply] = t->pvLength[ply + 1] > (size_t)ply + 1
+                           ? t->pvLength[ply + 1]
+                           : (size_t)ply + 1;
+}
+
+static bool isEnabled(const SearchThread *t, SearchFeature feature)
+{
+    return (t->limits.disabled & feature) == 0;
+}
+
+// without pieces besides pawns zugzwang is common, and passing is not a
+// fair test of the position
+static bool hasNonPawnMaterial(const Board *b, Colour c)
+{
+    return (b->colours[c] &
+            ~(b->pieces[PIECE_PAWN] | b->pieces[PIECE_KING])) != 0;
+}
+
+// search captures until the position is quiet, so the evaluation is not
+// taken in the middle of an exchange
+static int quiescence(SearchThread *t, int alpha, int beta, int ply)
+{
+    Board *b         = &t->board;
+    t->pvLength[ply] = ply;
+    t->nodes++;
+
+    if (shouldStop(t))
+        return 0;
+    if (ply >= MAX_PLY - 1)
+        return evaluate(b, &t->pawns);
+
+    // the side to move can usually do at least as well as the static score
+    // by not capturing, unless it is in check
+    bool inCheck = isKingAttacked(b, b->turn);
+    int best     = -INFINITE_SCORE;
+    if (!inCheck)
+    {
+        best = evaluate(b, &t->pawns);
+        if (best >= beta)
+            return best;
+        if (best > alpha)
+            alpha = best;
+    }
+
+    // out of check every evasion is searched
+    MovePicker picker;
+    if (inCheck)
+        initMovePicker(&picker, b, MOVE_NONE, NULL, &t->history);
+    else
+        initNoisyPicker(&picker, b);
+
+    PackedMove m;
+    while ((m = nextMove(&picker)) != MOVE_NONE)
+    {
+        MoveUndo undo;
+        makeMove(b, m, &undo);
+        int score = -quiescence(t, -beta, -alpha, ply + 1);
+        unmakeMove(b, m, &undo);
+
+        if (t->stopped)
+            return 0;
+        if (score > best)
+        {
+            best = score;
+            if (score > alpha)
+                alpha = score;
+            if (alpha >= beta)
+                break;
+        }
+    }
+
+    // no evasion was found
+    if (inCheck && best == -INFINITE_SCORE)
+        return -MATE_SCORE + ply;
+    return best;
+}
+
+// a quiet move caused a cutoff. remember it for the other positions at this
+// ply, and prefer it over the quiet moves tried before it
+static void updateQuietStats(
+    SearchThread *t,
+    int ply,
+    int depth,
+    PackedMove m,
+    const PackedMove *tried,
+    size_t triedCount)
+{
+    PackedMove *killers = t->killers[ply];
+    if (killers[0] != m)
+    {
+        killers[1] = killers[0];
+        killers[0] = m;
+    }
+
+    int bonus = depth * depth < 400 ? depth * depth : 400;
+    updateHistory(&t->history, t->board.turn, m, bonus);
+    for (size_t i = 0; i < triedCount; i++)
+        updateHistory(&t->history, t->board.turn, tried[i], -bonus);
+}
+
+static bool isSearchedAtRoot(const SearchLimits *limits, PackedMove m)
+{
+    if (limits->searchMoves == NULL)
+        return true;
+    for (size_t i = 0; i < limits->searchMoveCount; i++)
+    {
+        if (limits->searchMoves[i] == m)
+            return true;
+    }
+    return false;
+}
+
+static int search(SearchThread *t, int alpha, int beta, int depth, int ply)
+{
+    Board *b         = &t->board;
+    t->pvLength[ply] = ply;
+
+    if (depth <= 0)
+        return quiescence(t, alpha, beta, ply);
+
+    t->nodes++;
+    if (ply > 0 && (shouldStop(t) || isDraw(t, ply)))
+        return 0;
+    if (ply >= MAX_PLY - 1)
+        return evaluate(b, &t->pawns);
+
+    // a deep enough earlier search of this position may already settle it.
+    // principal variation nodes are searched anyway to keep their lines
+    const bool pvNode       = beta - alpha > 1;
+    const int originalAlpha = alpha;
+    PackedMove ttMove       = MOVE_NONE;
+    TTEntry entry;
+    if (t->tt)
+    {
+        t->ttProbes++;
+        if (probeTT(t->tt, b->hash, &entry))
+        {
+            t->ttHits++;
+            ttMove    = entry.move;
+            int score = scoreFromTT(entry.score, ply);
+            if (!pvNode && ply > 0 && entry.depth >= depth &&
+                (entry.bound == BOUND_EXACT ||
+                 (entry.bound == BOUND_LOWER && score >= beta) ||
+                 (entry.bound == BOUND_UPPER && score <= alpha)))
+                return score;
+        }
+    }
+
+    // look one move further when in check, the replies are forced
+    bool inCheck = isKingAttacked(b, b->turn);
+    if (inCheck)
+        depth++;
+
+    // the pruning below trusts the static evaluation, which is meaningless
+    // in check and too rough to decide principal variation nodes
+    const bool canPrune = !pvNode && !inCheck && ply > 0;
+    const int staticEval =
+        canPrune ? evaluate(b, &t->pawns) : -INFINITE_SCORE;
+
+    // far enough above beta that no quiet reply will bring it back
+    if (canPrune && isEnabled(t, SEARCH_FUTILITY) &&
+        depth <= REVERSE_FUTILITY_DEPTH && abs(beta) < MATE_BOUND &&
+        staticEval - REVERSE_FUTILITY_MARGIN * depth >= beta)
+        return staticEval;
+
+    // if passing still fails high in a reduced search, a real move would too
+    if (canPrune && isEnabled(t, SEARCH_NULL_MOVE) && depth >= 3 &&
+        !t->nullMoves[ply] && staticEval >= beta &&
+        hasNonPawnMaterial(b, b->turn))
+    {
+        int reduction = 3 + depth / 6;
+        t->followPv   = false;
+
+        MoveUndo undo;
+        makeNullMove(b, &undo);
+        t->hashes[ply + 1]    = b->hash;
+        t->nullMoves[ply + 1] = true;
+        int score = -search(t, -beta, -beta + 1, depth - 1 - reduction, ply + 1);
+        t->nullMoves[ply + 1] = false;
+        unmakeNullMove(b, &undo);
+
+        if (t->stopped)
+            return 0;
+        // a pass does not prove a mate
+        if (score >= beta)
+            return score >= MATE_BOUND ? beta : score;
+    }
+
+    // quiet moves are not searched once the evaluation is too far below
+    // alpha for them to catch up
+    const bool futile = canPrune && isEnabled(t, SEARCH_FUTILITY) &&
+                        depth <= FUTILITY_DEPTH && abs(alpha) < MATE_BOUND &&
+                        staticEval + FUTILITY_MARGIN * depth <= alpha;
+
+    PackedMove pvMove = MOVE_NONE;
+    if (t->followPv && (size_t)ply < t->previousPvLength)
+        pvMove = t->previousPv[ply];
+    else
+        t->followPv = false;
+
+    MovePicker picker;
+    initMovePicker(
+        &picker,
+        b,
+        pvMove != MOVE_NONE ? pvMove : ttMove,
+        t->killers[ply],
+        &t->history);
+
+    int best            = -INFINITE_SCORE;
+    PackedMove bestMove = MOVE_NONE;
+    size_t searched     = 0;
+    // quiet moves that failed to cut off, punished if a later one does
+    PackedMove quiets[MAX_MOVES];
+    size_t quietCount = 0;
+
+    PackedMove m;
+    while ((m = nextMove(&picker)) != MOVE_NONE)
+    {
+        if (ply == 0 && !isSearchedAtRoot(&t->limits, m))
+            continue;
+
+        size_t i = searched++;
+        // only the first move can continue the previous line
+        if (i > 0 || m != pvMove)
+            t->followPv = false;
+
+        const bool quiet = getMoveKind(m) == GENERATE_QUIET;
+
+        MoveUndo undo;
+        makeMove(b, m, &undo);
+        const bool givesCheck = isKingAttacked(b, b->turn);
+
+        // one move is always searched, so pruning never fakes a mate
+        if (futile && quiet && !givesCheck && i > 0)
+        {
+            unmakeMove(b, m, &undo);
+            continue;
+        }
+
+        t->hashes[ply + 1]    = b->hash;
+        t->nullMoves[ply + 1] = false;
+        if (t->tt)
+            prefetchTT(t->tt, b->hash);
+
+        // the first move is expected to be best. the others only need to be
+        // shown to be worse, unless that fails. late quiet moves are shown
+        // so with a shallower search first
+        int score;
+        if (i == 0)
+            score = -search(t, -beta, -alpha, depth - 1, ply + 1);
+        else
+        {
+            int reduction = 0;
+            if (isEnabled(t, SEARCH_LATE_MOVE_REDUCTIONS) && depth >= 3 &&
+                i >= 3 && quiet && !inCheck && !givesCheck)
+            {
+                reduction = reductions[depth < 64 ? depth : 63]
+                                      [i < 64 ? i : 63] -
+                            pvNode;
+                if (reduction > depth - 2)
+                    reduction = depth - 2;
+                if (reduction < 0)
+                    reduction = 0;
+            }
+
+            score =
+                -search(t, -alpha - 1, -alpha, depth - 1 - reduction, ply + 1);
+            if (score > alpha && reduction > 0)
+                score = -search(t, -alpha - 1, -alpha, depth - 1, ply + 1);
+            if (score > alpha && score < beta)
+                score = -search(t, -beta, -alpha, depth - 1, ply + 1);
+        }
+        unmakeMove(b, m, &undo);
+
+        if (t->stopped)
+            return 0;
+        if (score > best)
+        {
+            best = score;
+            if (score > alpha)
+            {
+                alpha    = score;
+                bestMove = m;
+                updatePv(t, ply, m);
+                if (alpha >= beta)
+                {
+                    t->cutoffs++;
+                    t->firstMoveCutoffs += i == 0;
+                    if (quiet)
+                        updateQuietStats(t, ply, depth, m, quiets, quietCount);
+                    break;
+                }
+            }
+        }
+        if (quiet)
+            quiets[quietCount++] = m;
+    }
+
+    if (searched == 0)
+        return inCheck ? -MATE_SCORE + ply : 0;
+
+    if (t->tt)
+    {
+        Bound bound = best >= beta            ? BOUND_LOWER
+                      : best <= originalAlpha ? BOUND_UPPER
+                                              : BOUND_EXACT;
+        t->ttStores++;
+        t->ttOverwrites += storeTT(
+            t->tt, b->hash, bestMove, scoreToTT(best, ply), depth, bound);
+    }
+    return best;
+}
+
+static void copyLine(const SearchThread *t, SearchResult *result)
+{
+    result->score    = t->score;
+    result->depth    = t->depth;
+    result->pvLength = t->previousPvLength;
+    memcpy(result->pv, t->previousPv, t->previousPvLength * sizeof(PackedMove));
+    result->bestMove = result->pv[0];
+}
+
+static void addStats(const SearchThread *t, SearchResult *result)
+{
+    result->ttProbes += t->ttProbes;
+    result->ttHits += t->ttHits;
+    result->ttStores += t->ttStores;
+    result->ttOverwrites += t->ttOverwrites;
+    result->pawnProbes += t->pawns.probes;
+    result->pawnHits += t->pawns.hits;
+    result->cutoffs += t->cutoffs;
+    result->firstMoveCutoffs += t->firstMoveCutoffs;
+}
+
+// iterative deepening. the threads share what they find through the
+// transposition table, and every other helper searches a ply ahead so they
+// fill the table with deeper results rather than all repeating the main
+// thread's iteration
+static void *runSearchThread(void *data)
+{
+    SearchThread *t      = data;
+    SearchShared *shared = t->shared;
+    // iterations in a row the main thread's best move has not changed for
+    PackedMove lastBest = MOVE_NONE;
+    unsigned stable     = 0;
+    for (unsigned depth = 1 + (t->id & 1); depth <= shared->maxDepth; depth++)
+    {
+        // a score outside the window is only a bound, so the root is searched
+        // again with the window widened on that side
+        int delta = ASPIRATION_WINDOW;
+        int alpha = -INFINITE_SCORE;
+        int beta  = INFINITE_SCORE;
+        if (isEnabled(t, SEARCH_ASPIRATION) && depth >= ASPIRATION_DEPTH &&
+            abs(t->score) < MATE_BOUND)
+        {
+            alpha = t->score - delta;
+            beta  = t->score + delta;
+        }
+
+        int score;
+        for (;;)
+        {
+            t->followPv = true;
+            score       = search(t, alpha, beta, depth, 0);
+            if (t->stopped)
+                break;
+
+            delta *= 2;
+            if (score <= alpha)
+                alpha = score - delta < -MATE_BOUND ? -INFINITE_SCORE
+                                                    : score - delta;
+            else if (score >= beta)
+                beta = score + delta > MATE_BOUND ? INFINITE_SCORE
+                                                  : score + delta;
+            else
+                break;
+        }
+
+        // an unfinished iteration is thrown away
+        if (t->stopped)
+            break;
+
+        t->score = score;
+        t->depth = depth;
+        memcpy(t->previousPv, t->pv[0], t->pvLength[0] * sizeof(PackedMove));
+        t->previousPvLength = t->pvLength[0];
+
+        // only the main thread reports
+        if (t->id != 0)
+            continue;
+
+        SearchResult *result = shared->result;
+        stable   = t->previousPv[0] == lastBest ? stable + 1 : 0;
+        lastBest = t->previousPv[0];
+        copyLine(t, result);
+        result->nodes =
+            atomic_load(&shared->nodes) + t->nodes - t->flushedNodes;
+        result->seconds             = seconds() - shared->start;
+        result->depthSeconds[depth] = result->seconds;
+        if (t->limits.report)
+            t->limits.report(result, t->limits.reportData);
+
+        // the next iteration would likely not finish in time
+        if (shared->timed &&
+            shouldStopIterating(
+                &shared->budget, result->seconds * 1000, stable))
+            break;
+    }
+
+    // the helpers are only there to help the main thread
+    if (t->id == 0)
+        atomic_store(&shared->stop, true);
+    return NULL;
+}
+
+PackedMove
+searchBestMove(Board *b, const SearchLimits *limits, SearchResult *result)
+{
+    memset(result, 0, sizeof(SearchResult));
+
+    // fall back on any legal move if the first iteration is cut short
+    MoveList rootMoves;
+    generateMoves(b, &rootMoves);
+    if (rootMoves.count == 0)
+    {
+        result->score = isKingAttacked(b, b->turn) ? -MATE_SCORE : 0;
+        return MOVE_NONE;
+    }
+    result->bestMove = rootMoves.moves[0];
+    for (size_t i = 0; i < rootMoves.count; i++)
+    {
+        if (isSearchedAtRoot(limits, rootMoves.moves[i]))
+        {
+            result->bestMove = rootMoves.moves[i];
+            break;
+        }
+    }
+
+    unsigned count = limits->threads ? limits->threads : 1;
+    if (count > MAX_SEARCH_THREADS)
+        count = MAX_SEARCH_THREADS;
+    result->threads = count;
+
+    SearchShared shared = {
+        .start    = seconds(),
+        .maxDepth = MAX_PLY - 1,
+        .result   = result,
+    };
+    atomic_init(&shared.stop, false);
+    atomic_init(&shared.nodes, 0);
+    if (limits->depth && limits->depth < shared.maxDepth)
+        shared.maxDepth = limits->depth;
+
+    shared.deadline = limits->movetime;
+    if (limits->time)
+    {
+        shared.timed  = true;
+        shared.budget = allocateTime(
+            limits->time, limits->increment, limits->movesToGo);
+        if (!shared.deadline || shared.budget.hard < shared.deadline)
+            shared.deadline = shared.budget.hard;
+    }
+
+    if (limits->tt)
+        ageTT(limits->tt);
+
+    // without the memory for every thread, search with the main thread
+    SearchThread *threads =
+        aligned_alloc(_Alignof(SearchThread), count * sizeof(SearchThread));
+    if (threads == NULL && count > 1)
+    {
+        count   = 1;
+        threads = aligned_alloc(_Alignof(SearchThread), sizeof(SearchThread));
+    }
+    if (threads == NULL)
+    {
+        result->bestMove = MOVE_NONE;
+        return MOVE_NONE;
+    }
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        SearchThread *t     = &threads[i];
+        t->board            = *b;
+        t->limits           = *limits;
+        t->shared           = &shared;
+        t->id               = i;
+        t->nodes            = 0;
+        t->flushedNodes     = 0;
+        t->stopped          = false;
+        t->hashes[0]        = b->hash;
+        t->nullMoves[0]     = false;
+        t->previousPvLength = 0;
+        t->score            = 0;
+        t->depth            = 0;
+        t->tt               = limits->tt;
+        t->ttProbes         = 0;
+        t->ttHits           = 0;
+        t->ttStores         = 0;
+        t->ttOverwrites     = 0;
+        clearPawnCache(&t->pawns);
+        memset(t->killers, 0, sizeof(t->killers));
+        memset(t->history, 0, sizeof(t->history));
+        t->cutoffs          = 0;
+        t->firstMoveCutoffs = 0;
+
+        t->board.accumulator = NULL;
+        if (getEvaluator() == EVALUATOR_NETWORK)
+        {
+            t->board.accumulator = &t->accumulator;
+            refreshAccumulator(&t->accumulator, &t->board);
+        }
+    }
+
+    // the calling thread is the main thread. the helpers are started in
+    // order, the search goes on with those that started if one fails
+    pthread_t *handles = malloc(count * sizeof(pthread_t));
+    unsigned started   = 1;
+    while (handles && started < count &&
+           pthread_create(
+               &handles[started],
+               NULL,
+               runSearchThread,
+               &threads[started]) == 0)
+        started++;
+    count           = started;
+    result->threads = count;
+
+    runSearchThread(&threads[0]);
+    for (unsigned i = 1; i < count; i++)
+        pthread_join(handles[i], NULL);
+    free(handles);
+
+    // the deepest completed iteration is the most reliable, the main
+    // thread's on a tie
+    SearchThread *best = &threads[0];
+    for (unsigned i = 1; i < count; i++)
+    {
+        if (threads[i].depth > best->depth)
+            best = &threads[i];
+    }
+    if (best->depth > 0)
+        copyLine(best, result);
+
+    result->nodes = 0;
+    for (unsigned i = 0; i < count; i++)
+    {
+        result->threadNodes[i] = threads[i].nodes;
+        result->nodes += threads[i].nodes;
+        addStats(&threads[i], result);
+    }
+    result->seconds = seconds() - shared.start;
+
+    free(threads);
+    return result->bestMove;
+}
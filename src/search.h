@@ -0,0 +1,124 @@
+#pragma once
+
+// find the best move in a position with an iterative deepening principal
+// variation search
+
+#include "board.h"
+#include "moves.h"
+#include "tt.h"
+
+#include <stdatomic.h>
+
+// deepest the search can go, including quiescence
+#define MAX_PLY 128
+
+// scores beyond this are mates, MATE_SCORE - n is mate in n plies
+#define MATE_SCORE 32000
+#define MATE_BOUND (MATE_SCORE - MAX_PLY)
+#define INFINITE_SCORE 32001
+
+#define MAX_SEARCH_THREADS 256
+
+typedef struct SearchResult SearchResult;
+
+// selective search techniques. they are all on unless disabled in the
+// limits, so their effect can be measured at a fixed depth
+typedef enum
+{
+    // let the opponent move twice. if a shallow search still fails high the
+    // position is good enough to cut off
+    SEARCH_NULL_MOVE = 1 << 0,
+    // search moves late in the ordering less deeply, and again at full depth
+    // if they turn out better than expected
+    SEARCH_LATE_MOVE_REDUCTIONS = 1 << 1,
+    // near the leaves, skip quiet moves when the static evaluation is far
+    // below alpha, and cut off when it is far above beta
+    SEARCH_FUTILITY = 1 << 2,
+    // search the root in a narrow window around the previous iteration's
+    // score, widening it when the score falls outside
+    SEARCH_ASPIRATION = 1 << 3,
+} SearchFeature;
+
+// called after each completed iteration
+typedef void (*SearchReport)(const SearchResult *result, void *data);
+
+// a zero limit means no limit. with no limits at all the search only ends
+// once it reaches MAX_PLY
+typedef struct
+{
+    unsigned depth;
+    uint64_t nodes;
+    unsigned long movetime; // milliseconds
+
+    // the clock of the side to move, in milliseconds, which the time
+    // manager splits between the moves left. movesToGo is 0 when the rest
+    // of the game must be played in the time left
+    unsigned long time;
+    unsigned long increment;
+    unsigned movesToGo;
+
+    // kept between searches by the caller. NULL searches without one
+    TranspositionTable *tt;
+    // threads searching together through the transposition table, 0 is
+    // treated as 1. without a table the extra threads only repeat the work
+    unsigned threads;
+    // SearchFeature flags to turn off
+    unsigned disabled;
+
+    // set from another thread to end the search early. NULL if nothing
+    // will. it is read as often as the clock
+    atomic_bool *stop;
+
+    // hashes of the positions played in the game before the one searched,
+    // oldest first, so repeating one of them is seen as a draw. NULL if
+    // there are none
+    const uint64_t *history;
+    size_t historyLength;
+
+    // the legal moves the root chooses between. NULL searches all of them
+    const PackedMove *searchMoves;
+    size_t searchMoveCount;
+
+    SearchReport report;
+    void *reportData;
+} SearchLimits;
+
+struct SearchResult
+{
+    PackedMove bestMove;
+    int score;      // centipawns for the side to move
+    unsigned depth; // last completed iteration
+    uint64_t nodes;
+    double seconds;
+
+    PackedMove pv[MAX_PLY];
+    size_t pvLength;
+
+    // transposition table use. overwrites count stores that replaced
+    // another position's entry
+    uint64_t ttProbes;
+    uint64_t ttHits;
+    uint64_t ttStores;
+    uint64_t ttOverwrites;
+
+    // pawn structure cache use
+    uint64_t pawnProbes;
+    uint64_t pawnHits;
+
+    // beta cutoffs, and how many of them came from the first move searched.
+    // the closer the two are the better the moves were ordered
+    uint64_t cutoffs;
+    uint64_t firstMoveCutoffs;
+
+    // nodes searched by each thread, the first is the calling thread
+    unsigned threads;
+    uint64_t threadNodes[MAX_SEARCH_THREADS];
+    // seconds from the start until each depth was completed
+    double depthSeconds[MAX_PLY];
+};
+
+// search for the best move for the side to move. the board is not changed.
+// returns the best move, or MOVE_NONE if there are no legal moves or not
+// enough memory to search. result->threads is the number that searched
+PackedMove
+searchBestMove(Board *b, const SearchLimits *limits, SearchResult *result);
@@ -0,0 +1,46 @@
+#include "timeman.h"
+
+// soft limit used, in percent, by how many iterations the best move has
+// been the same for
+static const unsigned stabilityScale[STABLE_ITERATIONS + 1] = {
+    150, 120, 100, 80, 50,
+};
+
+TimeBudget
+allocateTime(unsigned long time, unsigned long increment, unsigned movesToGo)
+{
+    unsigned long available = time > MOVE_OVERHEAD ? time - MOVE_OVERHEAD : 1;
+
+    unsigned moves = EXPECTED_MOVES;
+    if (movesToGo && movesToGo < moves)
+        moves = movesToGo;
+
+    // most of the increment can be spent, it comes back after the move
+    TimeBudget budget = {
+        .soft = available / moves + increment * 3 / 4,
+        .hard = available / moves * 4 + increment * 3 / 4,
+    };
+
+    // never risk more than most of what is left on one move
+    unsigned long most = available - available / 4;
+    if (most < 1)
+        most = 1;
+    if (budget.hard > most)
+        budget.hard = most;
+    if (budget.soft > budget.hard)
+        budget.soft = budget.hard;
+    return budget;
+}
+
+bool shouldStopIterating(
+    const TimeBudget *budget, unsigned long elapsed, unsigned stableIterations)
+{
+    if (stableIterations > STABLE_ITERATIONS)
+        stableIterations = STABLE_ITERATIONS;
+
+    // a scaled up soft limit still gives way to the hard one
+    unsigned long limit = budget->soft * stabilityScale[stableIterations] / 100;
+    if (limit > budget->hard)
+        limit = budget->hard;
+    return elapsed >= limit;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+// splitting the time left on the clock between the moves still to play.
+// each move gets a soft limit, after which no new iteration is started, and
+// a hard limit, at which the search is stopped wherever it is
+
+#include <stdbool.h>
+
+// kept back from every move for the time it takes to send it
+#define MOVE_OVERHEAD 30
+
+// moves the rest of the game is expected to last when the time control
+// does not say
+#define EXPECTED_MOVES 30
+
+// iterations the best move must not change for before the search can stop
+// early
+#define STABLE_ITERATIONS 4
+
+typedef struct
+{
+    unsigned long soft; // milliseconds
+    unsigned long hard;
+} TimeBudget;
+
+// time is what remains on the clock for the side to move and increment
+// what it gains per move, in milliseconds. movesToGo is the number of moves
+// until the next time control, 0 for the rest of the game
+TimeBudget
+allocateTime(unsigned long time, unsigned long increment, unsigned movesToGo);
+
+// whether an iteration finished after elapsed milliseconds is a good place
+// to stop. the longer the best move has been stable the less of the soft
+// limit is used, while a best move that keeps changing gets more time
+bool shouldStopIterating(
+    const TimeBudget *budget, unsigned long elapsed, unsigned stableIterations);
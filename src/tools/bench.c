@@ -0,0 +1,289 @@
+// fixed depth search benchmark, built without any rendering dependencies
+//
+//   bench [options] <depth> [fen]   search the bench positions, or one
+//                                   position, to a fixed depth
+//
+// options:
+//   -t <threads>   search with several threads sharing the hash table
+//   --hash <mb>    hash table size, 16 by default
+//   --scaling      also search with one thread and compare the time taken
+//                  to reach each depth
+//   --nnue <file>  evaluate with a network instead of the classical
+//                  evaluation
+//   --kernel <name>  network kernel: scalar, sse4.1 or avx2. the fastest
+//                    supported one by default
+//   --disable <list>  comma separated search techniques to turn off: null,
+//                     lmr, futility and aspiration
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../board.h"
+#include "../fen.h"
+#include "../moves.h"
+#include "../nnue.h"
+#include "../position.h"
+#include "../search.h"
+#include "../tt.h"
+
+static const char *benchPositions[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "8/8/1P2K3/8/2n5/1q6/8/5k2 b - - 0 1",
+    "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1",
+};
+
+#define BENCH_POSITIONS (sizeof(benchPositions) / sizeof(benchPositions[0]))
+
+static unsigned threads = 1;
+static size_t hashMb    = 16;
+static bool scaling     = false;
+static unsigned disabled = 0;
+static TranspositionTable tt;
+
+// totals over every position searched in one run
+typedef struct
+{
+    uint64_t nodes;
+    double seconds;
+    uint64_t pawnProbes;
+    uint64_t pawnHits;
+    uint64_t cutoffs;
+    uint64_t firstMoveCutoffs;
+    uint64_t threadNodes[MAX_SEARCH_THREADS];
+    double depthSeconds[MAX_PLY];
+} BenchTotals;
+
+static void runPositions(
+    const char **fens,
+    size_t count,
+    unsigned depth,
+    unsigned searchThreads,
+    BenchTotals *totals,
+    bool print)
+{
+    memset(totals, 0, sizeof(BenchTotals));
+    for (size_t i = 0; i < count; i++)
+    {
+        Board b;
+        FenError error = loadPosition(&b, fens[i]);
+        if (error != FEN_OK)
+        {
+            printf("%zu: invalid FEN: %s\n", i + 1, getFenErrorName(error));
+            continue;
+        }
+
+        // every position starts from an empty table so runs compare
+        clearTT(&tt);
+        SearchLimits limits = {
+            .depth    = depth,
+            .tt       = &tt,
+            .threads  = searchThreads,
+            .disabled = disabled,
+        };
+        SearchResult result;
+        PackedMove best = searchBestMove(&b, &limits, &result);
+
+        totals->nodes += result.nodes;
+        totals->seconds += result.seconds;
+        totals->pawnProbes += result.pawnProbes;
+        totals->pawnHits += result.pawnHits;
+        totals->cutoffs += result.cutoffs;
+        totals->firstMoveCutoffs += result.firstMoveCutoffs;
+        for (unsigned t = 0; t < result.threads; t++)
+            totals->threadNodes[t] += result.threadNodes[t];
+        for (unsigned d = 1; d <= result.depth; d++)
+            totals->depthSeconds[d] += result.depthSeconds[d];
+
+        if (print)
+        {
+            char name[6];
+            moveToString(best, name);
+            printf(
+                "%zu: %s score %d depth %u nodes %" PRIu64 "\n",
+                i + 1,
+                name,
+                result.score,
+                result.depth,
+                result.nodes);
+        }
+    }
+}
+
+static void printTotals(const BenchTotals *totals, unsigned searchThreads)
+{
+    printf("Nodes searched: %" PRIu64 "\n", totals->nodes);
+    printf("Time: %.3f s\n", totals->seconds);
+    printf(
+        "Nodes/second: %.0f\n",
+        totals->seconds > 0 ? totals->nodes / totals->seconds
+                            : (double)totals->nodes);
+    printf(
+        "Pawn cache: %" PRIu64 " probes, %" PRIu64 " hits (%.1f%%)\n",
+        totals->pawnProbes,
+        totals->pawnHits,
+        totals->pawnProbes ? 100.0 * totals->pawnHits / totals->pawnProbes
+                           : 0.0);
+    printf(
+        "Cutoffs: %" PRIu64 ", %.1f%% on the first move\n",
+        totals->cutoffs,
+        totals->cutoffs ? 100.0 * totals->firstMoveCutoffs / totals->cutoffs
+                        : 0.0);
+
+    if (searchThreads <= 1)
+        return;
+    for (unsigned t = 0; t < searchThreads; t++)
+    {
+        printf(
+            "Thread %u: %" PRIu64 " nodes (%.1f%%)\n",
+            t,
+            totals->threadNodes[t],
+            totals->nodes ? 100.0 * totals->threadNodes[t] / totals->nodes
+                          : 0.0);
+    }
+}
+
+static void printUsage(const char *name)
+{
+    printf("usage: %s [options] <depth> [fen]\n", name);
+    printf("options: -t <threads> --hash <mb> --scaling --nnue <file> "
+           "--kernel <name> --disable <list>\n");
+}
+
+static const struct
+{
+    const char *name;
+    SearchFeature feature;
+} featureNames[] = {
+    {"null", SEARCH_NULL_MOVE},
+    {"lmr", SEARCH_LATE_MOVE_REDUCTIONS},
+    {"futility", SEARCH_FUTILITY},
+    {"aspiration", SEARCH_ASPIRATION},
+};
+
+// returns false if a name is not known
+static bool parseFeatures(char *list, unsigned *features)
+{
+    for (char *name = strtok(list, ","); name; name = strtok(NULL, ","))
+    {
+        size_t i = 0;
+        while (i < sizeof(featureNames) / sizeof(featureNames[0]) &&
+               strcmp(featureNames[i].name, name))
+            i++;
+        if (i == sizeof(featureNames) / sizeof(featureNames[0]))
+            return false;
+        *features |= featureNames[i].feature;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    // options come first, whatever is left is positional
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if (strcmp(argv[arg], "-t") == 0 && arg + 1 < argc)
+            threads = atoi(argv[++arg]);
+        else if (strcmp(argv[arg], "--hash") == 0 && arg + 1 < argc)
+            hashMb = atoi(argv[++arg]);
+        else if (strcmp(argv[arg], "--scaling") == 0)
+            scaling = true;
+        else if (strcmp(argv[arg], "--nnue") == 0 && arg + 1 < argc)
+        {
+            if (!loadNetwork(argv[++arg]))
+            {
+                printf("Failed to load network '%s'\n", argv[arg]);
+                return 1;
+            }
+            setEvaluator(EVALUATOR_NETWORK);
+        }
+        else if (strcmp(argv[arg], "--disable") == 0 && arg + 1 < argc)
+        {
+            if (!parseFeatures(argv[++arg], &disabled))
+            {
+                printf("Search techniques are null, lmr, futility and "
+                       "aspiration\n");
+                return 1;
+            }
+        }
+        else if (strcmp(argv[arg], "--kernel") == 0 && arg + 1 < argc)
+        {
+            const char *name = argv[++arg];
+            NnueKernel k     = NNUE_KERNEL_SCALAR;
+            while (k <= NNUE_KERNEL_AVX2 && strcmp(getNnueKernelName(k), name))
+                k++;
+            if (!selectNnueKernel(k))
+            {
+                printf("Kernel '%s' is not supported\n", name);
+                return 1;
+            }
+        }
+        else
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (threads < 1 || threads > MAX_SEARCH_THREADS)
+    {
+        printf("Thread count must be between 1 and %d\n", MAX_SEARCH_THREADS);
+        return 1;
+    }
+    if (argc - arg < 1 || atoi(argv[arg]) < 1 || atoi(argv[arg]) >= MAX_PLY)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+    unsigned depth = atoi(argv[arg]);
+
+    const char **fens = benchPositions;
+    size_t count      = BENCH_POSITIONS;
+    if (argc - arg >= 2)
+    {
+        fens  = (const char **)&argv[arg + 1];
+        count = 1;
+    }
+
+    if (!createTT(&tt, hashMb))
+    {
+        printf("Failed to allocate the hash table\n");
+        return 1;
+    }
+
+    if (getEvaluator() == EVALUATOR_NETWORK)
+        printf("Network kernel: %s\n", getNnueKernelName(getNnueKernel()));
+
+    BenchTotals totals;
+    runPositions(fens, count, depth, threads, &totals, true);
+    printf("\n");
+    printTotals(&totals, threads);
+
+    if (scaling && threads > 1)
+    {
+        // time to depth is what extra threads buy, they do not search
+        // fewer nodes
+        BenchTotals single;
+        runPositions(fens, count, depth, 1, &single, false);
+        printf("\nDepth  1 thread  %u threads  speedup\n", threads);
+        for (unsigned d = 1; d <= depth; d++)
+        {
+            double many = totals.depthSeconds[d];
+            printf(
+                "%5u  %7.3f s  %8.3f s  %6.2fx\n",
+                d,
+                single.depthSeconds[d],
+                many,
+                many > 0 ? single.depthSeconds[d] / many : 0.0);
+        }
+    }
+
+    destroyTT(&tt);
+    return 0;
+}
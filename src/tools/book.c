@@ -0,0 +1,192 @@
+// builds opening books from games and looks positions up in them, built
+// without any rendering dependencies
+//
+//   book build [-p <plies>] <pgn> <book>   build a book from the first
+//                                          plies of every game, 20 by
+//                                          default
+//   book probe <book> [fen]                list a position's book moves
+//
+// as Polyglot counts them, a move played by the side that won the game
+// weighs 2, a move from a drawn game or one without a result weighs 1 and
+// a move by the side that lost is left out
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../board.h"
+#include "../book.h"
+#include "../fen.h"
+#include "../moves.h"
+#include "../pgn.h"
+
+#define START_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+
+#define DEFAULT_PLIES 20
+
+static unsigned getMoveWeight(PgnResult result, Colour side)
+{
+    switch (result)
+    {
+    case PGN_RESULT_WHITE: return side == COLOUR_WHITE ? 2 : 0;
+    case PGN_RESULT_BLACK: return side == COLOUR_BLACK ? 2 : 0;
+    default: return 1;
+    }
+}
+
+// every game's first moves as entries, grown as they are read
+typedef struct
+{
+    BookEntry *entries;
+    size_t count;
+    size_t capacity;
+} EntryList;
+
+static bool addEntry(EntryList *list, BookEntry entry)
+{
+    if (list->count == list->capacity)
+    {
+        size_t capacity = list->capacity ? list->capacity * 2 : 1 << 16;
+        BookEntry *entries =
+            realloc(list->entries, capacity * sizeof(BookEntry));
+        if (entries == NULL)
+            return false;
+        list->entries  = entries;
+        list->capacity = capacity;
+    }
+    list->entries[list->count++] = entry;
+    return true;
+}
+
+static int build(const char *pgnPath, const char *bookPath, unsigned plies)
+{
+    PgnReader *reader = malloc(sizeof(PgnReader));
+    PgnGame *game     = malloc(sizeof(PgnGame));
+    if (reader == NULL || game == NULL || !openPgn(reader, pgnPath))
+    {
+        printf("Failed to read '%s'\n", pgnPath);
+        free(reader);
+        free(game);
+        return 1;
+    }
+
+    // games with a bad move still give the moves before it
+    EntryList list = {.entries = NULL};
+    size_t games   = 0;
+    bool ok        = true;
+    while (ok && readPgnGame(reader, game) != PGN_END)
+    {
+        games++;
+        Board b = game->start;
+        for (size_t i = 0; ok && i < game->moveCount && i < plies; i++)
+        {
+            unsigned weight = getMoveWeight(game->result, b.turn);
+            if (weight)
+            {
+                ok = addEntry(
+                    &list,
+                    (BookEntry){
+                        .key    = getBookKey(&b),
+                        .move   = encodeBookMove(game->moves[i]),
+                        .weight = weight,
+                    });
+            }
+            MoveUndo undo;
+            makeMove(&b, game->moves[i], &undo);
+        }
+    }
+    closePgn(reader);
+    free(reader);
+    free(game);
+    if (!ok)
+    {
+        printf("Out of memory after %zu games\n", games);
+        free(list.entries);
+        return 1;
+    }
+
+    FILE *file = fopen(bookPath, "wb");
+    ok         = file && writeBook(file, list.entries, list.count);
+    if (file && fclose(file) != 0)
+        ok = false;
+    free(list.entries);
+    if (!ok)
+    {
+        printf("Failed to write '%s'\n", bookPath);
+        return 1;
+    }
+
+    printf("Games: %zu\n", games);
+    printf("Moves: %zu\n", list.count);
+    return 0;
+}
+
+static int probe(const char *bookPath, const char *fen)
+{
+    Board b;
+    FenError error = loadPosition(&b, fen);
+    if (error != FEN_OK)
+    {
+        printf("Invalid FEN: %s\n", getFenErrorName(error));
+        return 1;
+    }
+
+    OpeningBook book;
+    if (!openBook(bookPath, &book))
+    {
+        printf("Failed to open '%s'\n", bookPath);
+        return 1;
+    }
+
+    BookMove moves[BOOK_MAX_MOVES];
+    size_t count   = probeBook(&book, &b, moves, BOOK_MAX_MOVES);
+    uint64_t total = 0;
+    for (size_t i = 0; i < count; i++)
+        total += moves[i].weight;
+
+    printf("Key: %016" PRIx64 "\n", getBookKey(&b));
+    printf("Entries: %zu\n", book.count);
+    for (size_t i = 0; i < count; i++)
+    {
+        char san[SAN_MAX_LENGTH];
+        moveToSan(&b, moves[i].move, san);
+        printf(
+            "%-8s %6u  %5.1f%%\n",
+            san,
+            moves[i].weight,
+            total ? 100.0 * moves[i].weight / total : 0.0);
+    }
+    if (count == 0)
+        printf("Not in the book\n");
+
+    closeBook(&book);
+    return 0;
+}
+
+static void printUsage(const char *name)
+{
+    printf("usage: %s build [-p <plies>] <pgn> <book>\n", name);
+    printf("       %s probe <book> [fen]\n", name);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc >= 4 && strcmp(argv[1], "build") == 0)
+    {
+        unsigned plies = DEFAULT_PLIES;
+        int arg        = 2;
+        if (strcmp(argv[arg], "-p") == 0 && argc == 6)
+        {
+            plies = atoi(argv[arg + 1]);
+            arg += 2;
+        }
+        if (argc - arg == 2)
+            return build(argv[arg], argv[arg + 1], plies);
+    }
+    else if (argc >= 3 && argc <= 4 && strcmp(argv[1], "probe") == 0)
+        return probe(argv[2], argc == 4 ? argv[3] : START_FEN);
+
+    printUsage(argv[0]);
+    return 1;
+}
@@ -0,0 +1,468 @@
+// checks for the readers and writers, built without any rendering
+// dependencies, each run over a file of cases in tests/
+//
+//   check fen <file>   parse every FEN and compare the error with the one
+//                      expected. the valid ones must be written back the
+//                      same
+//   check pgn <file>   read every game, write it and read it again. the
+//                      games must be read without errors and come back
+//                      the same
+//   check packed <epd> pack every position in an EPD file and unpack it.
+//                      it must come back the same
+//   check book <file>  compare the book key of every position with the
+//                      one expected
+//   check nnue <epd>   evaluate every position in an EPD file and the
+//                      positions after each of its moves with a random
+//                      network, with every kernel the processor has. the
+//                      kernels must agree, and with an accumulator kept up
+//                      to date by the moves
+//
+// the FEN and key cases are one to a line. blank lines and '#' lines
+// are skipped
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../board.h"
+#include "../book.h"
+#include "../fen.h"
+#include "../moves.h"
+#include "../nnue.h"
+#include "../packed.h"
+#include "../pgn.h"
+
+// most a written game takes in a case
+#define MAX_WRITTEN (1 << 16)
+
+// the name a case file gives each FenError
+static const char *const fenErrorNames[] = {
+    [FEN_OK]             = "ok",
+    [FEN_BAD_PIECE]      = "piece",
+    [FEN_BAD_BOARD]      = "board",
+    [FEN_BAD_KINGS]      = "kings",
+    [FEN_BAD_COUNT]      = "count",
+    [FEN_BAD_PAWNS]      = "pawns",
+    [FEN_BAD_TURN]       = "turn",
+    [FEN_BAD_CASTLING]   = "castling",
+    [FEN_BAD_EN_PASSANT] = "en-passant",
+    [FEN_BAD_CLOCK]      = "clock",
+    [FEN_ILLEGAL]        = "illegal",
+};
+
+#define FEN_ERROR_COUNT (sizeof(fenErrorNames) / sizeof(fenErrorNames[0]))
+
+// cut the spaces and newline off the end of a string
+static void trimEnd(char *s)
+{
+    size_t length = strlen(s);
+    while (length > 0 && strchr(" \t\r\n", s[length - 1]))
+        s[--length] = '\0';
+}
+
+// each line is a FEN, then ';' and the name of the error it gives
+static int checkFen(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        printf("Failed to open '%s'\n", path);
+        return 1;
+    }
+
+    char line[512];
+    size_t cases = 0, failures = 0;
+    while (fgets(line, sizeof(line), file))
+    {
+        char *expected = strchr(line, ';');
+        if (line[0] == '#' || expected == NULL)
+            continue;
+        *expected++ = '\0';
+        trimEnd(line);
+        trimEnd(expected);
+        while (*expected == ' ')
+            expected++;
+        cases++;
+
+        Board b;
+        FenError error = loadPosition(&b, line);
+        if (error >= FEN_ERROR_COUNT || strcmp(fenErrorNames[error], expected))
+        {
+            failures++;
+            printf(
+                "FAIL %s: got %s, expected %s\n",
+                line,
+                error < FEN_ERROR_COUNT ? fenErrorNames[error] : "?",
+                expected);
+            continue;
+        }
+        if (error != FEN_OK)
+            continue;
+
+        char written[FEN_MAX_LENGTH];
+        writeFEN(&b, written);
+        if (strcmp(written, line))
+        {
+            failures++;
+            printf("FAIL %s: written as %s\n", line, written);
+        }
+    }
+    fclose(file);
+
+    printf("%zu cases, %zu failures\n", cases, failures);
+    return failures ? 1 : 0;
+}
+
+static bool isSameGame(const PgnGame *a, const PgnGame *b)
+{
+    if (a->tagCount != b->tagCount || a->start.hash != b->start.hash ||
+        a->moveCount != b->moveCount || a->result != b->result)
+        return false;
+    for (size_t i = 0; i < a->tagCount; i++)
+    {
+        if (strcmp(a->tags[i].name, b->tags[i].name) ||
+            strcmp(a->tags[i].value, b->tags[i].value))
+            return false;
+    }
+    return memcmp(a->moves, b->moves, a->moveCount * sizeof(PackedMove)) == 0;
+}
+
+// write a game and read it back
+static bool rereadGame(const PgnGame *game, PgnGame *reread)
+{
+    static char written[MAX_WRITTEN];
+    FILE *file = tmpfile();
+    if (file == NULL || !writePgnGame(file, game))
+    {
+        if (file)
+            fclose(file);
+        return false;
+    }
+    rewind(file);
+    size_t length = fread(written, 1, sizeof(written), file);
+    fclose(file);
+
+    static PgnReader reader;
+    openPgnMemory(&reader, written, length);
+    return readPgnGame(&reader, reread) == PGN_OK;
+}
+
+// a game's PlyCount tag, if it has one, is the number of moves it must have
+static int checkPgn(const char *path)
+{
+    static PgnReader reader;
+    static PgnGame game, reread;
+    if (!openPgn(&reader, path))
+    {
+        printf("Failed to open '%s'\n", path);
+        return 1;
+    }
+
+    size_t games = 0, failures = 0;
+    PgnStatus status;
+    while ((status = readPgnGame(&reader, &game)) != PGN_END)
+    {
+        games++;
+        const char *event    = getPgnTag(&game, "Event");
+        const char *plyCount = getPgnTag(&game, "PlyCount");
+        event                = event ? event : "?";
+        if (status != PGN_OK)
+        {
+            failures++;
+            printf("FAIL %s: error on line %zu\n", event, game.errorLine);
+        }
+        else if (plyCount && (size_t)atoi(plyCount) != game.moveCount)
+        {
+            failures++;
+            printf(
+                "FAIL %s: %zu moves, expected %s\n",
+                event,
+                game.moveCount,
+                plyCount);
+        }
+        else if (!rereadGame(&game, &reread) || !isSameGame(&game, &reread))
+        {
+            failures++;
+            printf("FAIL %s: not the same once written\n", event);
+        }
+    }
+    closePgn(&reader);
+
+    printf("%zu games, %zu failures\n", games, failures);
+    return failures ? 1 : 0;
+}
+
+// the positions are compared as FENs, which hold everything a record does
+static int checkPacked(const char *path)
+{
+    PositionSet set;
+    if (!loadEPD(path, &set))
+    {
+        printf("Failed to read '%s'\n", path);
+        return 1;
+    }
+    // one more than needed, so an empty file still gets an allocation
+    PackedPosition *packed = malloc(set.count * sizeof(PackedPosition) + 1);
+    Board *unpacked        = malloc(set.count * sizeof(Board) + 1);
+    if (packed == NULL || unpacked == NULL)
+    {
+        printf("Not enough memory for %zu positions\n", set.count);
+        free(unpacked);
+        free(packed);
+        freePositionSet(&set);
+        return 1;
+    }
+
+    size_t failures = !packPositions(set.boards, packed, set.count);
+    failures += !unpackPositions(packed, unpacked, set.count);
+    for (size_t i = 0; i < set.count; i++)
+    {
+        char fen[FEN_MAX_LENGTH], unpackedFen[FEN_MAX_LENGTH];
+        writeFEN(&set.boards[i], fen);
+        writeFEN(&unpacked[i], unpackedFen);
+        if (strcmp(fen, unpackedFen) || set.boards[i].hash != unpacked[i].hash)
+        {
+            failures++;
+            printf("FAIL %s: unpacked as %s\n", fen, unpackedFen);
+        }
+    }
+
+    // the FEN reader refuses a board with more pieces than a record holds,
+    // so one is made by hand
+    Board full = createBoard();
+    for (Position tile = 0; tile < 40; tile++)
+        setPiece(&full, tile, PIECE_QUEEN | 0x80);
+    setPiece(&full, 62, PIECE_KING);
+    setPiece(&full, 63, PIECE_KING | 0x80);
+    PackedPosition overflow;
+    if (packPosition(&full, &overflow))
+    {
+        failures++;
+        printf("FAIL 42 pieces: packed\n");
+    }
+
+    printf("%zu positions, %zu failures\n", set.count, failures);
+    free(unpacked);
+    free(packed);
+    freePositionSet(&set);
+    return failures ? 1 : 0;
+}
+
+// each line is a FEN, then ";key" and the key in hexadecimal
+static int checkBook(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        printf("Failed to open '%s'\n", path);
+        return 1;
+    }
+
+    char line[512];
+    size_t cases = 0, failures = 0;
+    while (fgets(line, sizeof(line), file))
+    {
+        char *expected = strchr(line, ';');
+        if (line[0] == '#' || expected == NULL)
+            continue;
+        *expected++ = '\0';
+        trimEnd(line);
+        cases++;
+
+        Board b;
+        uint64_t key;
+        FenError error = loadPosition(&b, line);
+        if (error != FEN_OK)
+        {
+            failures++;
+            printf("FAIL %s: %s\n", line, getFenErrorName(error));
+        }
+        else if (sscanf(expected, "key %" SCNx64, &key) != 1)
+        {
+            failures++;
+            printf("FAIL %s: no key\n", line);
+        }
+        else if (getBookKey(&b) != key)
+        {
+            failures++;
+            printf(
+                "FAIL %s: got %016" PRIx64 ", expected %016" PRIx64 "\n",
+                line,
+                getBookKey(&b),
+                key);
+        }
+    }
+    fclose(file);
+
+    printf("%zu cases, %zu failures\n", cases, failures);
+    return failures ? 1 : 0;
+}
+
+// splitmix64, so the network is the same every run
+static uint64_t nextRandom(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9e3779b97f4a7c15);
+    z          = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z          = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+}
+
+static void writeLittleEndian(FILE *file, uint64_t value, size_t size)
+{
+    for (size_t byte = 0; byte < size; byte++)
+        fputc(value >> (8 * byte) & 0xff, file);
+}
+
+// count numbers of size bytes, each from -range to range
+static void writeRandom(
+    FILE *file, uint64_t *state, size_t size, size_t count, int64_t range)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        int64_t value = (int64_t)(nextRandom(state) % (2 * range + 1)) - range;
+        writeLittleEndian(file, value, size);
+    }
+}
+
+// a network in the file format, with weights large enough that the sums
+// are clipped at both ends
+static bool loadRandomNetwork()
+{
+    FILE *file = tmpfile();
+    if (file == NULL)
+        return false;
+
+    uint64_t state = 0x6e6e7565;
+    fputs("CNUE", file);
+    writeLittleEndian(file, NNUE_VERSION, 4);
+    writeLittleEndian(file, NNUE_INPUTS, 4);
+    writeLittleEndian(file, NNUE_HIDDEN, 4);
+    writeLittleEndian(file, NNUE_LAYER1, 4);
+    writeRandom(file, &state, 2, NNUE_HIDDEN, 64);
+    writeRandom(file, &state, 2, NNUE_INPUTS * NNUE_HIDDEN, 48);
+    writeRandom(file, &state, 4, NNUE_LAYER1, 1 << 12);
+    writeRandom(file, &state, 1, NNUE_LAYER1 * 2 * NNUE_HIDDEN, 127);
+    writeRandom(file, &state, 4, 1, 1 << 12);
+    writeRandom(file, &state, 1, NNUE_LAYER1, 127);
+
+    rewind(file);
+    bool loaded = readNetwork(file);
+    fclose(file);
+    return loaded;
+}
+
+// the position's score with every kernel, and from a fresh accumulator.
+// returns false if any differ
+static bool checkKernels(Board *b, const char *fen)
+{
+    NnueAccumulator fresh;
+    refreshAccumulator(&fresh, b);
+
+    bool same = true;
+    int first = 0;
+    for (NnueKernel k = NNUE_KERNEL_SCALAR; k <= NNUE_KERNEL_AVX2; k++)
+    {
+        if (!selectNnueKernel(k))
+            continue;
+        int kept              = evaluateNetwork(b);
+        NnueAccumulator *used = b->accumulator;
+        b->accumulator        = &fresh;
+        int refreshed         = evaluateNetwork(b);
+        b->accumulator        = used;
+
+        if (k == NNUE_KERNEL_SCALAR)
+            first = kept;
+        if (kept != first || refreshed != first)
+        {
+            same = false;
+            printf(
+                "FAIL %s: %s gives %d and %d from scratch, scalar %d\n",
+                fen,
+                getNnueKernelName(k),
+                kept,
+                refreshed,
+                first);
+        }
+    }
+    return same;
+}
+
+static int checkNnue(const char *path)
+{
+    PositionSet set;
+    if (!loadEPD(path, &set))
+    {
+        printf("Failed to read '%s'\n", path);
+        return 1;
+    }
+    if (!loadRandomNetwork())
+    {
+        printf("Failed to load a network\n");
+        freePositionSet(&set);
+        return 1;
+    }
+
+    size_t positions = 0, failures = 0;
+    for (size_t i = 0; i < set.count; i++)
+    {
+        Board *b = &set.boards[i];
+        char fen[FEN_MAX_LENGTH];
+        writeFEN(b, fen);
+
+        NnueAccumulator acc;
+        refreshAccumulator(&acc, b);
+        b->accumulator = &acc;
+        positions++;
+        failures += !checkKernels(b, fen);
+
+        MoveList moves;
+        generateMoves(b, &moves);
+        for (size_t j = 0; j < moves.count; j++)
+        {
+            MoveUndo undo;
+            makeMove(b, moves.moves[j], &undo);
+            positions++;
+            failures += !checkKernels(b, fen);
+            unmakeMove(b, moves.moves[j], &undo);
+        }
+        b->accumulator = NULL;
+    }
+
+    // kernels the processor does not have were not compared
+    printf("Kernels:");
+    for (NnueKernel k = NNUE_KERNEL_SCALAR; k <= NNUE_KERNEL_AVX2; k++)
+    {
+        if (selectNnueKernel(k))
+            printf(" %s", getNnueKernelName(k));
+    }
+    printf("\n%zu positions, %zu failures\n", positions, failures);
+    freePositionSet(&set);
+    return failures ? 1 : 0;
+}
+
+static void printUsage(const char *name)
+{
+    printf("usage: %s fen <file>\n", name);
+    printf("       %s pgn <file>\n", name);
+    printf("       %s packed <epd>\n", name);
+    printf("       %s book <file>\n", name);
+    printf("       %s nnue <epd>\n", name);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 3 && strcmp(argv[1], "fen") == 0)
+        return checkFen(argv[2]);
+    if (argc == 3 && strcmp(argv[1], "pgn") == 0)
+        return checkPgn(argv[2]);
+    if (argc == 3 && strcmp(argv[1], "packed") == 0)
+        return checkPacked(argv[2]);
+    if (argc == 3 && strcmp(argv[1], "book") == 0)
+        return checkBook(argv[2]);
+    if (argc == 3 && strcmp(argv[1], "nnue") == 0)
+        return checkNnue(argv[2]);
+
+    printUsage(argv[0]);
+    return 1;
+}
@@ -0,0 +1,169 @@
+// reads a PGN or EPD file on several threads, replaying every game, and
+// reports what was in it. built without any rendering dependencies
+//
+//   ingest [options] <file>
+//
+// options:
+//   -t <threads>      worker threads, 1 by default
+//   -o <file>         write every position to a file, one FEN per line, in
+//                     file order
+//   --epd             read the file as EPD. files ending in .epd are read
+//                     as EPD anyway
+//   --packed          write the positions as a file of packed positions
+//                     rather than FENs
+//   --quiet           no progress reports
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../fen.h"
+#include "../ingest.h"
+#include "../packed.h"
+#include "../pgn.h"
+
+static void printProgress(const IngestStats *stats, void *data)
+{
+    (void)data;
+    fprintf(
+        stderr,
+        "\r%5.1f%%  %" PRIu64 " items  %.0f items/s  %.1f MB/s",
+        stats->totalBytes ? 100.0 * stats->bytes / stats->totalBytes : 100.0,
+        stats->items,
+        stats->seconds > 0 ? stats->items / stats->seconds : 0.0,
+        stats->seconds > 0 ? stats->bytes / stats->seconds / 1e6 : 0.0);
+}
+
+static const char *getErrorName(IngestFormat format, int code)
+{
+    if (format == INGEST_EPD)
+        return getFenErrorName(code);
+    switch (code)
+    {
+    case PGN_BAD_MOVE: return "illegal or ambiguous move";
+    case PGN_BAD_FEN: return "invalid FEN tag";
+    }
+    return "unknown error";
+}
+
+static void printStats(const IngestStats *stats, IngestFormat format)
+{
+    const char *items = format == INGEST_PGN ? "Games" : "Positions";
+    printf("%s: %" PRIu64 "\n", items, stats->items);
+    if (format == INGEST_PGN)
+    {
+        printf("Positions: %" PRIu64 "\n", stats->positions);
+        printf(
+            "Results: %" PRIu64 " white, %" PRIu64 " black, %" PRIu64
+            " drawn, %" PRIu64 " unknown\n",
+            stats->results[PGN_RESULT_WHITE],
+            stats->results[PGN_RESULT_BLACK],
+            stats->results[PGN_RESULT_DRAW],
+            stats->results[PGN_RESULT_UNKNOWN]);
+    }
+    printf("Errors: %" PRIu64 "\n", stats->errorCount);
+    for (size_t i = 0; i < stats->errorCount && i < INGEST_MAX_ERRORS; i++)
+    {
+        const IngestError *e = &stats->errors[i];
+        printf(
+            "  %s %" PRIu64 " line %" PRIu64 ": %s\n",
+            format == INGEST_PGN ? "game" : "position",
+            e->item,
+            e->line,
+            getErrorName(format, e->code));
+    }
+    printf("Time: %.3f s\n", stats->seconds);
+    printf(
+        "%s/second: %.0f\n",
+        items,
+        stats->seconds > 0 ? stats->items / stats->seconds : 0.0);
+    printf(
+        "MB/second: %.1f\n",
+        stats->seconds > 0 ? stats->bytes / stats->seconds / 1e6 : 0.0);
+}
+
+static void printUsage(const char *name)
+{
+    printf("usage: %s [options] <file>\n", name);
+    printf("options: -t <threads> -o <file> --epd --packed --quiet\n");
+}
+
+int main(int argc, char **argv)
+{
+    IngestOptions options = {
+        .format   = INGEST_PGN,
+        .threads  = 1,
+        .progress = printProgress,
+    };
+    const char *output = NULL;
+    bool epd           = false;
+
+    // options come first, whatever is left is positional
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if (strcmp(argv[arg], "-t") == 0 && arg + 1 < argc)
+            options.threads = atoi(argv[++arg]);
+        else if (strcmp(argv[arg], "-o") == 0 && arg + 1 < argc)
+            output = argv[++arg];
+        else if (strcmp(argv[arg], "--epd") == 0)
+            epd = true;
+        else if (strcmp(argv[arg], "--packed") == 0)
+            options.packed = true;
+        else if (strcmp(argv[arg], "--quiet") == 0)
+            options.progress = NULL;
+        else
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (argc - arg != 1)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (options.threads < 1 || options.threads > 256)
+    {
+        printf("Thread count must be between 1 and 256\n");
+        return 1;
+    }
+
+    const char *path = argv[arg];
+    size_t length    = strlen(path);
+    if (epd || (length > 4 && strcmp(path + length - 4, ".epd") == 0))
+        options.format = INGEST_EPD;
+
+    // a packed file's header is written again once the count is known
+    if (output)
+    {
+        options.positions = fopen(output, "wb");
+        if (options.positions == NULL ||
+            (options.packed && !writePackedHeader(options.positions, 0)))
+        {
+            printf("Failed to open '%s'\n", output);
+            return 1;
+        }
+    }
+
+    IngestStats stats;
+    bool ok = ingestFile(path, &options, &stats);
+    if (options.progress)
+        fprintf(stderr, "\n");
+    if (ok && options.positions && options.packed)
+    {
+        ok = fseek(options.positions, 0, SEEK_SET) == 0 &&
+             writePackedHeader(options.positions, stats.positions);
+    }
+    if (options.positions && fclose(options.positions) != 0)
+        ok = false;
+    if (!ok)
+    {
+        printf("Failed to read '%s'\n", path);
+        return 1;
+    }
+
+    printStats(&stats, options.format);
+    return 0;
+}
@@ -0,0 +1,302 @@
+// command line perft runner, built without any rendering dependencies
+//
+//   perft [options] <depth> [fen]            count one position, divided by
+//                                            root move
+//   perft [options] --suite <file> [depth]   check every position in an EPD
+//                                            suite
+//
+// options:
+//   -t <threads>   count with several threads
+//   -s <ply>       split the tree into tasks at ply 1 or 2 (default 1)
+//   --scaling      also count with one thread and report the speedup
+//   --hash <mb>    cache subtree counts in a table shared by the threads
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../board.h"
+#include "../fen.h"
+#include "../moves.h"
+#include "../perft.h"
+
+#define START_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+
+#define MAX_THREADS 256
+
+static unsigned threads  = 1;
+static unsigned splitPly = 1;
+static bool scaling      = false;
+static PerftCache cache  = {.entries = NULL};
+
+static double now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void printSpeed(uint64_t nodes, double seconds)
+{
+    printf("Nodes searched: %" PRIu64 "\n", nodes);
+    printf("Time: %.3f s\n", seconds);
+    printf(
+        "Nodes/second: %.0f\n", seconds > 0 ? nodes / seconds : (double)nodes);
+}
+
+// count with whichever of the perft variants the options ask for. returns
+// false if there is not enough memory for the threads
+static bool countNodes(
+    Board *b,
+    unsigned depth,
+    MoveList *moves,
+    uint64_t *counts,
+    PerftThreadStats *stats,
+    uint64_t *nodes)
+{
+    if (threads <= 1 && cache.entries == NULL)
+    {
+        *nodes = perftDivide(b, depth, moves, counts);
+        return true;
+    }
+
+    return perftParallel(
+        b,
+        depth,
+        threads,
+        splitPly,
+        cache.entries ? &cache : NULL,
+        moves,
+        counts,
+        stats,
+        nodes);
+}
+
+static void printCacheStats(const PerftCacheStats *stats)
+{
+    printf(
+        "Cache: %" PRIu64 " probes, %" PRIu64 " hits (%.1f%%)\n",
+        stats->probes,
+        stats->hits,
+        stats->probes ? 100.0 * stats->hits / stats->probes : 0.0);
+}
+
+static void addCacheStats(
+    PerftCacheStats *total, const PerftThreadStats *stats, unsigned count)
+{
+    for (unsigned t = 0; t < count; t++)
+    {
+        total->probes += stats[t].cache.probes;
+        total->hits += stats[t].cache.hits;
+    }
+}
+
+static int runDivide(unsigned depth, const char *fen)
+{
+    Board b;
+    FenError error = loadPosition(&b, fen);
+    if (error != FEN_OK)
+    {
+        printf("Invalid FEN: %s\n", getFenErrorName(error));
+        return 1;
+    }
+
+    MoveList moves;
+    uint64_t counts[MAX_MOVES];
+    PerftThreadStats stats[MAX_THREADS] = {0};
+
+    double start = now();
+    uint64_t nodes;
+    if (!countNodes(&b, depth, &moves, counts, stats, &nodes))
+    {
+        printf("Not enough memory for %u threads\n", threads);
+        return 1;
+    }
+    double elapsed = now() - start;
+
+    for (size_t i = 0; i < moves.count; i++)
+    {
+        char name[6];
+        moveToString(moves.moves[i], name);
+        printf("%s: %" PRIu64 "\n", name, counts[i]);
+    }
+    printf("\n");
+    printSpeed(nodes, elapsed);
+
+    if (cache.entries)
+    {
+        PerftCacheStats total = {0};
+        addCacheStats(&total, stats, threads);
+        printCacheStats(&total);
+    }
+
+    if (threads <= 1)
+        return 0;
+
+    printf("\n");
+    for (unsigned t = 0; t < threads; t++)
+    {
+        printf(
+            "Thread %u: %" PRIu64 " nodes, %zu tasks (%zu stolen), %.1f%% "
+            "busy\n",
+            t,
+            stats[t].nodes,
+            stats[t].tasks,
+            stats[t].stolen,
+            elapsed > 0 ? 100 * stats[t].busy / elapsed : 100.0);
+    }
+
+    if (scaling)
+    {
+        start = now();
+        perft(&b, depth);
+        double single = now() - start;
+        double speedup = elapsed > 0 ? single / elapsed : threads;
+        printf("One thread: %.3f s\n", single);
+        printf(
+            "Speedup: %.2fx, efficiency %.1f%%\n",
+            speedup,
+            100 * speedup / threads);
+    }
+    return 0;
+}
+
+// each line holds a FEN followed by the expected counts, as in
+// "<fen> ;D1 20 ;D2 400". depths above maxDepth are skipped
+static int runSuite(const char *path, unsigned maxDepth)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        printf("Failed to open suite '%s'\n", path);
+        return 1;
+    }
+
+    char line[512];
+    size_t positions = 0, failures = 0;
+    uint64_t totalNodes        = 0;
+    PerftCacheStats cacheStats = {0};
+    double start               = now();
+
+    while (fgets(line, sizeof(line), file))
+    {
+        char *expected = strchr(line, ';');
+        if (line[0] == '#' || expected == NULL)
+            continue;
+        *expected++ = '\0';
+
+        Board b;
+        FenError error = loadPosition(&b, line);
+        positions++;
+        if (error != FEN_OK)
+        {
+            failures++;
+            printf("FAIL %s: %s\n", line, getFenErrorName(error));
+            continue;
+        }
+
+        unsigned depth;
+        uint64_t count;
+        int read;
+        while (sscanf(expected, " D%u %" SCNu64 " %n", &depth, &count, &read) ==
+               2)
+        {
+            expected += read;
+            if (*expected == ';')
+                expected++;
+            if (depth > maxDepth)
+                continue;
+
+            MoveList moves;
+            uint64_t counts[MAX_MOVES];
+            PerftThreadStats stats[MAX_THREADS] = {0};
+            uint64_t nodes;
+            if (!countNodes(&b, depth, &moves, counts, stats, &nodes))
+            {
+                printf("Not enough memory for %u threads\n", threads);
+                fclose(file);
+                return 1;
+            }
+            addCacheStats(&cacheStats, stats, threads);
+            totalNodes += nodes;
+            if (nodes != count)
+            {
+                failures++;
+                printf(
+                    "FAIL %s depth %u: got %" PRIu64 ", expected %" PRIu64
+                    "\n",
+                    line,
+                    depth,
+                    nodes,
+                    count);
+            }
+        }
+    }
+    fclose(file);
+
+    printf("%zu positions, %zu failures\n", positions, failures);
+    printSpeed(totalNodes, now() - start);
+    if (cache.entries)
+        printCacheStats(&cacheStats);
+    return failures ? 1 : 0;
+}
+
+static void printUsage(const char *name)
+{
+    printf("usage: %s [options] <depth> [fen]\n", name);
+    printf("       %s [options] --suite <file> [max depth]\n", name);
+    printf("options: -t <threads> -s <split ply> --scaling --hash <mb>\n");
+}
+
+int main(int argc, char **argv)
+{
+    // options come first, whatever is left is positional
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-' && strcmp(argv[arg], "--suite");
+         arg++)
+    {
+        if (strcmp(argv[arg], "-t") == 0 && arg + 1 < argc)
+            threads = atoi(argv[++arg]);
+        else if (strcmp(argv[arg], "-s") == 0 && arg + 1 < argc)
+            splitPly = atoi(argv[++arg]);
+        else if (strcmp(argv[arg], "--scaling") == 0)
+            scaling = true;
+        else if (strcmp(argv[arg], "--hash") == 0 && arg + 1 < argc)
+        {
+            if (!createPerftCache(&cache, atoi(argv[++arg])))
+            {
+                printf("Failed to allocate the cache\n");
+                return 1;
+            }
+        }
+        else
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (threads < 1 || threads > MAX_THREADS)
+    {
+        printf("Thread count must be between 1 and %d\n", MAX_THREADS);
+        return 1;
+    }
+
+    if (argc - arg >= 2 && strcmp(argv[arg], "--suite") == 0)
+    {
+        return runSuite(
+            argv[arg + 1],
+            argc - arg >= 3 ? (unsigned)atoi(argv[arg + 2]) : UINT32_MAX);
+    }
+
+    if (argc - arg < 1 || atoi(argv[arg]) < 1)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+    const char *fen = argc - arg >= 2 ? argv[arg + 1] : START_FEN;
+    return runDivide(atoi(argv[arg]), fen);
+}
@@ -0,0 +1,477 @@
+// universal chess interface front end, built without any rendering
+// dependencies, for match runners and tournament managers
+//
+//   chess-uci   read commands from stdin and answer on stdout
+//
+// commands:
+//   uci, isready, ucinewgame, quit
+//   setoption name Hash value <mb>
+//   setoption name Threads value <threads>
+//   setoption name BookFile value <path>
+//   setoption name Ponder value <true | false>
+//   position [startpos | fen <fen>] [moves <move>...]
+//   go [depth <plies>] [nodes <nodes>] [movetime <ms>] [wtime <ms>]
+//      [btime <ms>] [winc <ms>] [binc <ms>] [movestogo <moves>] [infinite]
+//      [ponder] [searchmoves <move>...]
+//   stop, ponderhit
+//
+// commands are read on the main thread while the search runs on another,
+// so stop is answered in the middle of a search. with a book, go plays one
+// of its moves without searching while the position is in it
+//
+// go ponder searches without a clock until stop or ponderhit. ponderhit
+// means the expected move was played, so the search starts again on the
+// clock, finding what pondering left in the transposition table
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../board.h"
+#include "../book.h"
+#include "../fen.h"
+#include "../moves.h"
+#include "../search.h"
+#include "../tt.h"
+
+#define START_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+
+#define DEFAULT_HASH 16
+#define MAX_HASH 65536
+
+// positions kept from the game, for finding repetitions. the fifty move
+// rule ends a game long before this many
+#define MAX_HISTORY 256
+
+static Board board;
+// hashes of the positions before board since the last capture or pawn
+// move, the ones before it can not come again
+static uint64_t history[MAX_HISTORY];
+static size_t historyLength = 0;
+static TranspositionTable tt;
+static size_t hashMb    = DEFAULT_HASH;
+static unsigned threads = 1;
+static OpeningBook book;
+
+// the search in progress. its board and limits are copies, so the position
+// can not change under it
+static pthread_t searchHandle;
+static bool searching = false;
+static Board searchBoard;
+static SearchLimits searchLimits;
+// an infinite search waits for stop even once it has nothing left to search
+static bool infinite;
+static atomic_bool stopRequested;
+// a pondering search waits too. the limits it is given on ponderhit are
+// kept, and it ends without a move when ponderhit stops it
+static bool pondering;
+static SearchLimits ponderLimits;
+static atomic_bool ponderHit;
+// the moves of go searchmoves
+static PackedMove searchMoves[MAX_MOVES];
+
+// the search thread prints too
+static pthread_mutex_t outputLock = PTHREAD_MUTEX_INITIALIZER;
+
+static void send(const char *format, ...)
+{
+    pthread_mutex_lock(&outputLock);
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+    fflush(stdout);
+    pthread_mutex_unlock(&outputLock);
+}
+
+// mate scores are given in moves rather than plies
+static void formatScore(int score, char *buffer, size_t size)
+{
+    if (score >= MATE_BOUND)
+        snprintf(buffer, size, "mate %d", (MATE_SCORE - score + 1) / 2);
+    else if (score <= -MATE_BOUND)
+        snprintf(buffer, size, "mate %d", -(MATE_SCORE + score) / 2);
+    else
+        snprintf(buffer, size, "cp %d", score);
+}
+
+static void reportIteration(const SearchResult *result, void *data)
+{
+    (void)data;
+
+    char score[24];
+    formatScore(result->score, score, sizeof(score));
+
+    // a move is at most 5 characters and a space
+    char pv[MAX_PLY * 6 + 1] = "";
+    char *end                = pv;
+    for (size_t i = 0; i < result->pvLength; i++)
+    {
+        *end++ = ' ';
+        moveToString(result->pv[i], end);
+        end += strlen(end);
+    }
+
+    unsigned long milliseconds = result->seconds * 1000;
+    send(
+        "info depth %u score %s nodes %" PRIu64 " nps %.0f time %lu pv%s\n",
+        result->depth,
+        score,
+        result->nodes,
+        result->seconds > 0 ? result->nodes / result->seconds : 0.0,
+        milliseconds,
+        pv);
+}
+
+static void *runSearch(void *data)
+{
+    (void)data;
+
+    SearchResult result;
+    PackedMove best = searchBestMove(&searchBoard, &searchLimits, &result);
+
+    // the interface decides when an infinite search is over
+    while ((infinite || pondering) && !atomic_load(&stopRequested))
+        nanosleep(&(struct timespec){.tv_nsec = 1000000}, NULL);
+    if (atomic_load(&ponderHit))
+        return NULL;
+
+    char name[6] = "0000";
+    if (best != MOVE_NONE)
+        moveToString(best, name);
+    send("bestmove %s\n", name);
+    return NULL;
+}
+
+// end any search in progress, once it has given its move
+static void stopSearch()
+{
+    if (!searching)
+        return;
+    atomic_store(&stopRequested, true);
+    pthread_join(searchHandle, NULL);
+    searching = false;
+}
+
+static void resizeHash(size_t megabytes)
+{
+    destroyTT(&tt);
+    if (!createTT(&tt, megabytes))
+    {
+        send("info string failed to allocate %zu MB, using %d\n",
+             megabytes,
+             DEFAULT_HASH);
+        megabytes = DEFAULT_HASH;
+        createTT(&tt, megabytes);
+    }
+    hashMb = megabytes;
+}
+
+static void setOption(char **save)
+{
+    // option names may have spaces, the name runs up to "value"
+    char name[64] = "";
+    char *token   = strtok_r(NULL, " ", save);
+    if (token == NULL || strcmp(token, "name"))
+        return;
+    while ((token = strtok_r(NULL, " ", save)) && strcmp(token, "value"))
+    {
+        if (name[0])
+            strncat(name, " ", sizeof(name) - strlen(name) - 1);
+        strncat(name, token, sizeof(name) - strlen(name) - 1);
+    }
+    // the value is the rest of the line, a path may have spaces in it
+    char *value = strtok_r(NULL, "", save);
+    if (value == NULL)
+        return;
+
+    if (strcmp(name, "Hash") == 0)
+    {
+        long megabytes = atol(value);
+        if (megabytes >= 1 && megabytes <= MAX_HASH)
+            resizeHash(megabytes);
+    }
+    else if (strcmp(name, "Threads") == 0)
+    {
+        long count = atol(value);
+        if (count >= 1 && count <= MAX_SEARCH_THREADS)
+            threads = count;
+    }
+    else if (strcmp(name, "BookFile") == 0)
+    {
+        closeBook(&book);
+        if (strcmp(value, "<empty>") && !openBook(value, &book))
+            send("info string failed to open book %s\n", value);
+    }
+    // Ponder only tells the interface it may send go ponder
+    else if (strcmp(name, "Ponder"))
+        send("info string unknown option %s\n", name);
+}
+
+// play a move of the game, remembering the position it was played from
+static void playMove(PackedMove m)
+{
+    if (historyLength == MAX_HISTORY)
+    {
+        memmove(history, history + 1, (MAX_HISTORY - 1) * sizeof(uint64_t));
+        historyLength--;
+    }
+    history[historyLength++] = board.hash;
+
+    MoveUndo undo;
+    makeMove(&board, m, &undo);
+    if (board.halfmoveClock == 0)
+        historyLength = 0;
+}
+
+static void setPosition(char **save)
+{
+    char *token = strtok_r(NULL, " ", save);
+    if (token == NULL)
+        return;
+    historyLength = 0;
+
+    if (strcmp(token, "startpos") == 0)
+    {
+        loadPosition(&board, START_FEN);
+        token = strtok_r(NULL, " ", save);
+    }
+    else if (strcmp(token, "fen") == 0)
+    {
+        // the fields of the fen are separate tokens up to the moves
+        char fen[128] = "";
+        while ((token = strtok_r(NULL, " ", save)) && strcmp(token, "moves"))
+        {
+            if (fen[0])
+                strncat(fen, " ", sizeof(fen) - strlen(fen) - 1);
+            strncat(fen, token, sizeof(fen) - strlen(fen) - 1);
+        }
+        FenError error = loadPosition(&board, fen);
+        if (error != FEN_OK)
+        {
+            send("info string invalid fen: %s\n", getFenErrorName(error));
+            loadPosition(&board, START_FEN);
+            return;
+        }
+    }
+    else
+        return;
+
+    if (token == NULL || strcmp(token, "moves"))
+        return;
+    while ((token = strtok_r(NULL, " ", save)))
+    {
+        PackedMove m = parseMove(&board, token);
+        if (m == MOVE_NONE)
+        {
+            send("info string illegal move %s\n", token);
+            return;
+        }
+        playMove(m);
+    }
+}
+
+static void startSearch(const SearchLimits *limits)
+{
+    searchBoard  = board;
+    searchLimits = *limits;
+    atomic_store(&stopRequested, false);
+    atomic_store(&ponderHit, false);
+    searching = pthread_create(&searchHandle, NULL, runSearch, NULL) == 0;
+    if (!searching)
+        send("info string failed to start the search\nbestmove 0000\n");
+}
+
+static void go(char **save)
+{
+    SearchLimits limits = {
+        .tt            = &tt,
+        .threads       = threads,
+        .stop          = &stopRequested,
+        .report        = reportIteration,
+        .history       = history,
+        .historyLength = historyLength,
+    };
+    unsigned long clocks[2]     = {0, 0};
+    unsigned long increments[2] = {0, 0};
+    infinite                    = false;
+    pondering                   = false;
+
+    char *token = strtok_r(NULL, " ", save);
+    while (token)
+    {
+        if (strcmp(token, "searchmoves") == 0)
+        {
+            // the moves run up to the first token that is not one
+            PackedMove m;
+            while ((token = strtok_r(NULL, " ", save)) &&
+                   (m = parseMove(&board, token)) != MOVE_NONE)
+            {
+                if (limits.searchMoveCount < MAX_MOVES)
+                    searchMoves[limits.searchMoveCount++] = m;
+            }
+            if (limits.searchMoveCount)
+                limits.searchMoves = searchMoves;
+            continue;
+        }
+
+        // infinite and ponder are flags without a value
+        if (strcmp(token, "infinite") == 0)
+        {
+            infinite = true;
+            token    = strtok_r(NULL, " ", save);
+            continue;
+        }
+        if (strcmp(token, "ponder") == 0)
+        {
+            pondering = true;
+            token     = strtok_r(NULL, " ", save);
+            continue;
+        }
+
+        char *value = strtok_r(NULL, " ", save);
+        if (value == NULL)
+            break;
+        if (strcmp(token, "depth") == 0)
+            limits.depth = atoi(value);
+        else if (strcmp(token, "nodes") == 0)
+            limits.nodes = strtoull(value, NULL, 10);
+        else if (strcmp(token, "movetime") == 0)
+            limits.movetime = atol(value);
+        else if (strcmp(token, "wtime") == 0)
+            clocks[COLOUR_WHITE] = atol(value);
+        else if (strcmp(token, "btime") == 0)
+            clocks[COLOUR_BLACK] = atol(value);
+        else if (strcmp(token, "winc") == 0)
+            increments[COLOUR_WHITE] = atol(value);
+        else if (strcmp(token, "binc") == 0)
+            increments[COLOUR_BLACK] = atol(value);
+        else if (strcmp(token, "movestogo") == 0)
+            limits.movesToGo = atoi(value);
+        token = strtok_r(NULL, " ", save);
+    }
+
+    // a clock of 0 would mean no limit, so at least a millisecond is left
+    if (!infinite && (clocks[COLOUR_WHITE] || clocks[COLOUR_BLACK]))
+    {
+        limits.time = clocks[board.turn] ? clocks[board.turn] : 1;
+        limits.increment = increments[board.turn];
+    }
+    if (limits.depth >= MAX_PLY)
+        limits.depth = MAX_PLY - 1;
+
+    // the clock only starts on ponderhit
+    if (pondering)
+    {
+        ponderLimits    = limits;
+        limits.time     = 0;
+        limits.movetime = 0;
+    }
+
+    // analysis always searches, and pondering can not answer before it
+    // is told to
+    if (!infinite && !pondering && book.count)
+    {
+        uint64_t random = (uint64_t)rand() << 32 ^ rand();
+        PackedMove m    = pickBookMove(&book, &board, random);
+        if (m != MOVE_NONE)
+        {
+            char name[6];
+            moveToString(m, name);
+            send("bestmove %s\n", name);
+            return;
+        }
+    }
+
+    startSearch(&limits);
+}
+
+// the ponder search is replaced by one on the clock
+static void hitPonder()
+{
+    if (!searching || !pondering)
+        return;
+    atomic_store(&ponderHit, true);
+    stopSearch();
+    pondering = false;
+    startSearch(&ponderLimits);
+}
+
+int main()
+{
+    srand(time(NULL));
+    loadPosition(&board, START_FEN);
+    if (!createTT(&tt, hashMb))
+    {
+        printf("info string failed to allocate the hash table\n");
+        return 1;
+    }
+
+    char *line  = NULL;
+    size_t size = 0;
+    ssize_t length;
+    while ((length = getline(&line, &size, stdin)) >= 0)
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+
+        char *save;
+        char *command = strtok_r(line, " ", &save);
+        if (command == NULL)
+            continue;
+
+        if (strcmp(command, "uci") == 0)
+        {
+            send("id name Chess\n"
+                 "id author wkaelj\n"
+                 "option name Hash type spin default %d min 1 max %d\n"
+                 "option name Threads type spin default 1 min 1 max %d\n"
+                 "option name BookFile type string default <empty>\n"
+                 "option name Ponder type check default false\n"
+                 "uciok\n",
+                 DEFAULT_HASH,
+                 MAX_HASH,
+                 MAX_SEARCH_THREADS);
+        }
+        else if (strcmp(command, "isready") == 0)
+            send("readyok\n");
+        else if (strcmp(command, "ucinewgame") == 0)
+        {
+            stopSearch();
+            clearTT(&tt);
+        }
+        else if (strcmp(command, "setoption") == 0)
+        {
+            stopSearch();
+            setOption(&save);
+        }
+        else if (strcmp(command, "position") == 0)
+        {
+            stopSearch();
+            setPosition(&save);
+        }
+        else if (strcmp(command, "go") == 0)
+        {
+            stopSearch();
+            go(&save);
+        }
+        else if (strcmp(command, "stop") == 0)
+            stopSearch();
+        else if (strcmp(command, "ponderhit") == 0)
+            hitPonder();
+        else if (strcmp(command, "quit") == 0)
+            break;
+    }
+
+    stopSearch();
+    free(line);
+    closeBook(&book);
+    destroyTT(&tt);
+    return 0;
+}
@@ -0,0 +1,153 @@
+#include "tt.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+// a position's entry is only replaced by a shallower result of the same
+// search if it is at most this many plies shallower, or exact
+#define TT_DEPTH_MARGIN 3
+
+bool createTT(TranspositionTable *tt, size_t megabytes)
+{
+    // round down to a power of two so the index is a mask
+    size_t count = 1;
+    while (count * 2 * sizeof(TTBucket) <= megabytes << 20)
+        count *= 2;
+
+    tt->buckets = aligned_alloc(sizeof(TTBucket), count * sizeof(TTBucket));
+    tt->mask    = count - 1;
+    tt->age     = 0;
+    if (tt->buckets == NULL)
+        return false;
+
+    clearTT(tt);
+    return true;
+}
+
+void destroyTT(TranspositionTable *tt)
+{
+    free(tt->buckets);
+    tt->buckets = NULL;
+}
+
+void clearTT(TranspositionTable *tt)
+{
+    memset(tt->buckets, 0, (tt->mask + 1) * sizeof(TTBucket));
+}
+
+void ageTT(TranspositionTable *tt) { tt->age++; }
+
+size_t getTTSize(const TranspositionTable *tt)
+{
+    return (tt->mask + 1) * sizeof(TTBucket);
+}
+
+static uint64_t packEntry(const TTEntry *e)
+{
+    return (uint64_t)e->move | (uint64_t)(uint16_t)e->score << 16 |
+           (uint64_t)e->depth << 32 | (uint64_t)e->bound << 40 |
+           (uint64_t)e->age << 48;
+}
+
+static TTEntry unpackEntry(uint64_t data)
+{
+    return (TTEntry){
+        .move  = data & 0xffff,
+        .score = (int16_t)(data >> 16),
+        .depth = data >> 32,
+        .bound = data >> 40,
+        .age   = data >> 48,
+    };
+}
+
+// read a slot, as data and the hash it was stored for. relaxed atomics
+// compile to plain loads, the xor check catches a store from another thread
+// landing in between
+static uint64_t loadSlot(TTSlot *slot, uint64_t *hash)
+{
+    uint64_t data = atomic_load_explicit(&slot->data, memory_order_relaxed);
+    *hash = atomic_load_explicit(&slot->check, memory_order_relaxed) ^ data;
+    return data;
+}
+
+bool probeTT(TranspositionTable *tt, uint64_t hash, TTEntry *entry)
+{
+    TTBucket *bucket = &tt->buckets[hash & tt->mask];
+    for (size_t i = 0; i < TT_BUCKET_ENTRIES; i++)
+    {
+        uint64_t stored;
+        uint64_t data = loadSlot(&bucket->entries[i], &stored);
+        *entry        = unpackEntry(data);
+        if (stored == hash && entry->bound != BOUND_NONE)
+            return true;
+    }
+    return false;
+}
+
+bool storeTT(
+    TranspositionTable *tt,
+    uint64_t hash,
+    PackedMove move,
+    int score,
+    unsigned depth,
+    Bound bound)
+{
+    TTBucket *bucket = &tt->buckets[hash & tt->mask];
+
+    // reuse this position's entry if it has one. otherwise replace the
+    // entry worth least, where each search of age costs eight plies of depth
+    TTSlot *victim   = &bucket->entries[0];
+    TTEntry old      = {0};
+    uint64_t oldHash = 0;
+    int victimWorth  = INT_MAX;
+    for (size_t i = 0; i < TT_BUCKET_ENTRIES; i++)
+    {
+        uint64_t stored;
+        TTEntry e = unpackEntry(loadSlot(&bucket->entries[i], &stored));
+        if (stored == hash || e.bound == BOUND_NONE)
+        {
+            victim  = &bucket->entries[i];
+            old     = e;
+            oldHash = stored;
+            break;
+        }
+
+        int worth = e.depth - 8 * (uint8_t)(tt->age - e.age);
+        if (worth < victimWorth)
+        {
+            victim      = &bucket->entries[i];
+            old         = e;
+            oldHash     = stored;
+            victimWorth = worth;
+        }
+    }
+
+    bool overwrite = old.bound != BOUND_NONE && oldHash != hash;
+
+    // keep the old move rather than forget it
+    if (move == MOVE_NONE && oldHash == hash)
+        move = old.move;
+
+    TTEntry e = {
+        .move  = move,
+        .score = (int16_t)score,
+        .depth = depth > UINT8_MAX ? UINT8_MAX : depth,
+        .bound = bound,
+        .age   = tt->age,
+    };
+
+    // a deeper result for the position from this search is worth more than
+    // a shallow bound, such as one from quiescence or another thread. only
+    // its move is updated
+    if (oldHash == hash && old.bound != BOUND_NONE && old.age == tt->age &&
+        bound != BOUND_EXACT && e.depth + TT_DEPTH_MARGIN < old.depth)
+    {
+        old.move = move;
+        e        = old;
+    }
+    uint64_t data = packEntry(&e);
+    atomic_store_explicit(&victim->data, data, memory_order_relaxed);
+    atomic_store_explicit(&victim->check, data ^ hash, memory_order_relaxed);
+    return overwrite;
+}
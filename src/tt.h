@@ -0,0 +1,85 @@
+#pragma once
+
+// transposition table. remembers the result of searching a position so
+// the search can reuse it when the position is reached again
+
+#include "board.h"
+#include "moves.h"
+
+#include <stdatomic.h>
+
+// what the stored score says about the true score
+typedef enum
+{
+    BOUND_NONE = 0,
+    BOUND_UPPER, // the true score is at most the stored score
+    BOUND_LOWER, // the true score is at least the stored score
+    BOUND_EXACT,
+} Bound;
+
+// an entry as read out of the table
+typedef struct
+{
+    PackedMove move;
+    int16_t score;
+    uint8_t depth;
+    uint8_t bound;
+    uint8_t age; // search generation that wrote the entry
+} TTEntry;
+
+// an entry as stored, packed into two words: the data, and the hash xored
+// with it. the table is shared by every search thread without locks, so a
+// torn write fails the check instead of being read back as another
+// position's entry
+typedef struct
+{
+    _Atomic uint64_t check;
+    _Atomic uint64_t data;
+} TTSlot;
+
+#define TT_BUCKET_ENTRIES 4
+
+// entries sharing a slot, sized and aligned to one cache line so a lookup
+// touches a single line
+typedef struct
+{
+    TTSlot entries[TT_BUCKET_ENTRIES];
+} __attribute__((aligned(64))) TTBucket;
+
+typedef struct
+{
+    TTBucket *buckets;
+    size_t mask; // bucket count - 1, the count is a power of two
+    uint8_t age;
+} TranspositionTable;
+
+// allocate a table using at most megabytes of memory, at least one bucket.
+// returns false if the memory could not be allocated
+bool createTT(TranspositionTable *tt, size_t megabytes);
+void destroyTT(TranspositionTable *tt);
+// forget every entry
+void clearTT(TranspositionTable *tt);
+// start a new search, entries from older searches are replaced first
+void ageTT(TranspositionTable *tt);
+// size of the table in bytes
+size_t getTTSize(const TranspositionTable *tt);
+
+// find the entry for a position. returns false if there is none
+bool probeTT(TranspositionTable *tt, uint64_t hash, TTEntry *entry);
+
+// store the result of a search. returns true if an entry for a different
+// position had to be overwritten
+bool storeTT(
+    TranspositionTable *tt,
+    uint64_t hash,
+    PackedMove move,
+    int score,
+    unsigned depth,
+    Bound bound);
+
+// start loading a position's bucket into the cache. called as soon as a
+// move is made, so the bucket is ready by the time the position is probed
+static inline void prefetchTT(const TranspositionTable *tt, uint64_t hash)
+{
+    __builtin_prefetch(&tt->buckets[hash & tt->mask]);
+}
@@ -0,0 +1,51 @@
+#include "zobrist.h"
+
+uint64_t zobristPieces[2][PIECE_PIECE_MAX][64];
+uint64_t zobristCastling[16];
+uint64_t zobristEnPassant[8];
+uint64_t zobristTurn;
+
+// splitmix64, good enough to give well spread keys from a counter
+static uint64_t nextKey(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9e3779b97f4a7c15);
+    z          = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z          = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+}
+
+__attribute__((constructor)) void initZobrist()
+{
+    uint64_t state = 0x436865737331;
+
+    for (size_t c = 0; c < 2; c++)
+    {
+        for (size_t piece = 0; piece < PIECE_PIECE_MAX; piece++)
+        {
+            for (size_t tile = 0; tile < 64; tile++)
+            {
+                zobristPieces[c][piece][tile] =
+                    piece == PIECE_BLANK ? 0 : nextKey(&state);
+            }
+        }
+    }
+
+    // castling keys are built from one key per right, so any combination of
+    // rights hashes the same as removing them one at a time
+    uint64_t rightKeys[4];
+    for (size_t i = 0; i < 4; i++)
+        rightKeys[i] = nextKey(&state);
+    for (size_t rights = 0; rights < 16; rights++)
+    {
+        zobristCastling[rights] = 0;
+        for (size_t i = 0; i < 4; i++)
+        {
+            if (rights & (1 << i))
+                zobristCastling[rights] ^= rightKeys[i];
+        }
+    }
+
+    for (size_t file = 0; file < 8; file++)
+        zobristEnPassant[file] = nextKey(&state);
+    zobristTurn = nextKey(&state);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+// random keys for each part of the board state. a position's hash is the
+// xor of the keys for everything in it, so a change to the board updates
+// the hash by xoring the old and new keys
+
+#include "board.h"
+
+// indexed by colour, piece type and tile. blank pieces have zero keys
+extern uint64_t zobristPieces[2][PIECE_PIECE_MAX][64];
+// indexed by the castling rights bitmask
+extern uint64_t zobristCastling[16];
+// indexed by en passant file
+extern uint64_t zobristEnPassant[8];
+// included when white is to move
+extern uint64_t zobristTurn;
+
+// build the keys. it is run automatically before main, the seed is fixed so
+// every build and every peer agrees on the keys
+void initZobrist();
+
+static inline uint64_t zobristPiece(Piece p, Position tile)
+{
+    return zobristPieces[getColour(p)][p & 0x7f][tile];
+}